@@ -0,0 +1,261 @@
+#include "pg_mock_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// previous receive path: two reads per message (header, then body)
+task<message> get_message_unbuffered(auto &s) {
+    message m;
+    co_await boost::asio::async_read(s, boost::asio::buffer(&m.h, sizeof(m.h)), boost::asio::use_awaitable);
+    m.data.resize(m.h.length + 1);
+    memcpy(m.data.data(), &m.h, sizeof(header));
+    co_await boost::asio::async_read(s, boost::asio::buffer(m.data.data() + sizeof(header), m.h.length - sizeof(m.h.length)), boost::asio::use_awaitable);
+    co_return m;
+}
+
+// n data rows of a single int4 column, like a 'SELECT generate_series(1, n)' result
+auto make_data_rows(size_t n) {
+    std::string row;
+    auto add = [&](auto v) {
+        row.append((const char *)&v, sizeof(v));
+    };
+    add(message_type<data_row>);
+    add(be_i32{4 + 2 + 4 + 4});
+    add(be<i16>{1});
+    add(be_i32{4});
+    add(be_i32{42});
+    std::string rows;
+    rows.reserve(row.size() * n);
+    for (size_t i = 0; i < n; ++i) {
+        rows += row;
+    }
+    return rows;
+}
+
+void bench_receive(auto &&name, size_t n, auto &&get_message) {
+    boost::asio::io_context ctx;
+    ip::tcp::acceptor a{ctx, ip::tcp::endpoint{ip::make_address_v4("127.0.0.1"), 0}};
+    ip::tcp::socket client{ctx}, server{ctx};
+    client.connect(a.local_endpoint());
+    a.accept(server);
+
+    auto rows = make_data_rows(n);
+    std::thread writer{[&] {
+        boost::asio::write(server, boost::asio::buffer(rows));
+    }};
+
+    auto start = std::chrono::steady_clock::now();
+    boost::asio::co_spawn(ctx, [&]() -> task<> {
+        for (size_t i = 0; i < n; ++i) {
+            co_await get_message(client);
+        }
+    }, boost::asio::detached);
+    ctx.run();
+    auto d = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    writer.join();
+
+    std::cout << std::format("{:12}: {} messages in {:.3f}s, {:.0f} messages/s\n", name, n, d, n / d);
+}
+
+// query latency on an event loop while n new connections log in there with SCRAM-SHA-256 against the mock backend
+// a few busy connections run queries back to back until the last login is done
+// warm: the keys of every user are in the process-wide cache (like reconnects after a failover),
+// cold: every login is a distinct user whose keys are derived, inline on the loop or on ex
+void bench_logins(auto &&name, size_t n, bool warm, boost::asio::any_io_executor ex) {
+    using clock = std::chrono::steady_clock;
+    // pg default scram_iterations
+    constexpr auto iterations = 4096;
+    constexpr size_t busy = 16;
+    auto q = "SELECT id, name FROM accounts WHERE id = 42"s;
+
+    boost::asio::io_context server_ctx;
+    pg_mock_server srv{server_ctx, "bench", iterations};
+    srv.on(q, pg_mock_result{{"id", "name"}}.row(42, "some customer name"));
+    srv.start();
+    std::thread server{[&] {
+        server_ctx.run();
+    }};
+
+    auto rethrow = [](std::exception_ptr e) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    };
+    // users of earlier runs must not be found
+    static int run;
+    ++run;
+    auto user = [&](size_t i) {
+        return std::format("login{}_{}", run, i);
+    };
+    {
+        auto &cache = scram_key_cache::instance();
+        std::lock_guard lk{cache.m};
+        cache.keys.clear();
+    }
+    boost::asio::io_context ctx;
+    if (warm) {
+        for (size_t i = 0; i < n; ++i) {
+            boost::asio::co_spawn(ctx, [&, u = user(i)]() -> task<> {
+                co_await scram_key_cache::instance().get(u, "bench", srv.salt, iterations);
+            }, rethrow);
+        }
+    }
+    std::vector<std::unique_ptr<pg_connection>> conns;
+    for (size_t i = 0; i < busy; ++i) {
+        conns.emplace_back(std::make_unique<pg_connection>(ctx, srv.connection_string("busy")));
+        boost::asio::co_spawn(ctx, conns.back()->connect(), rethrow);
+    }
+    ctx.run();
+    ctx.restart();
+
+    size_t done{};
+    std::vector<clock::duration> latency;
+    for (auto &&c : conns) {
+        boost::asio::co_spawn(ctx, [&, c = c.get()]() -> task<> {
+            while (done < n) {
+                auto t = clock::now();
+                co_await c->query(q);
+                latency.push_back(clock::now() - t);
+            }
+        }, rethrow);
+    }
+    auto start = clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        auto &c = conns.emplace_back(std::make_unique<pg_connection>(ctx, srv.connection_string(user(i))));
+        c->auth_executor = ex;
+        boost::asio::co_spawn(ctx, [&, c = c.get()]() -> task<> {
+            co_await c->connect();
+            ++done;
+        }, rethrow);
+    }
+    ctx.run();
+    auto d = std::chrono::duration<double>(clock::now() - start).count();
+
+    conns.clear();
+    boost::asio::post(server_ctx, [&] {
+        srv.stop();
+    });
+    server.join();
+
+    std::ranges::sort(latency);
+    auto ms = [&](double q) {
+        return std::chrono::duration<double, std::milli>(latency[std::min(latency.size() - 1, (size_t)(q * latency.size()))]).count();
+    };
+    std::cout << std::format("{:12}: {} logins in {:.3f}s, {} queries meanwhile, latency p50 {:.3f}ms p99 {:.3f}ms max {:.3f}ms\n",
+        name, n, d, latency.size(), ms(0.5), ms(0.99), ms(1));
+}
+
+// client throughput and latency against the in-process mock backend, which runs on its own thread
+// every connection runs the query back to back, a latency is one round trip of the extended protocol
+void bench_mock(auto &&name, size_t connections, size_t queries, const std::string &q, const pg_mock_result &result) {
+    using clock = std::chrono::steady_clock;
+
+    boost::asio::io_context server_ctx;
+    pg_mock_server srv{server_ctx, "bench"};
+    srv.on(q, result);
+    srv.start();
+    std::thread server{[&] {
+        server_ctx.run();
+    }};
+
+    auto rethrow = [](std::exception_ptr e) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    };
+    boost::asio::io_context ctx;
+    std::vector<std::unique_ptr<pg_connection>> conns;
+    for (size_t i = 0; i < connections; ++i) {
+        conns.emplace_back(std::make_unique<pg_connection>(ctx, srv.connection_string("bench")));
+        boost::asio::co_spawn(ctx, conns.back()->connect(), rethrow);
+    }
+    ctx.run();
+    ctx.restart();
+
+    auto per_connection = std::max<size_t>(queries / connections, 1);
+    std::vector<clock::duration> latency;
+    latency.reserve(per_connection * connections);
+    size_t rows{};
+    auto start = clock::now();
+    for (auto &&c : conns) {
+        boost::asio::co_spawn(ctx, [&, c = c.get()]() -> task<> {
+            for (size_t i = 0; i < per_connection; ++i) {
+                auto t = clock::now();
+                auto r = co_await c->query(q);
+                latency.push_back(clock::now() - t);
+                rows += r.size();
+            }
+        }, rethrow);
+    }
+    ctx.run();
+    auto d = std::chrono::duration<double>(clock::now() - start).count();
+
+    // sessions end when their clients disconnect
+    conns.clear();
+    boost::asio::post(server_ctx, [&] {
+        srv.stop();
+    });
+    server.join();
+
+    std::ranges::sort(latency);
+    auto ms = [&](double q) {
+        return std::chrono::duration<double, std::milli>(latency[std::min(latency.size() - 1, (size_t)(q * latency.size()))]).count();
+    };
+    std::cout << std::format("{:12}: {:4} connections, {} queries in {:.3f}s, {:.0f} queries/s {:.0f} rows/s, "
+        "latency p50 {:.3f}ms p99 {:.3f}ms p99.9 {:.3f}ms max {:.3f}ms\n",
+        name, connections, latency.size(), d, latency.size() / d, rows / d, ms(0.5), ms(0.99), ms(0.999), ms(1));
+}
+
+// a socket per connection on both sides
+void raise_fd_limit() {
+#ifndef _WIN32
+    rlimit l;
+    if (getrlimit(RLIMIT_NOFILE, &l) == 0 && l.rlim_cur < l.rlim_max) {
+        l.rlim_cur = l.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &l);
+    }
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    bench_receive("unbuffered", n, [](auto &s) {
+        return get_message_unbuffered(s);
+    });
+    receive_buffer input;
+    bench_receive("buffered", n, [&](auto &s) -> task<message> {
+        message_view m = co_await input.get_message(s);
+        co_return m.to_message();
+    });
+    bench_receive("views", n, [&](auto &s) {
+        return input.get_message(s);
+    });
+
+    // a socket per connection on both sides
+    raise_fd_limit();
+
+    bench_logins("login warm", 500, true, {});
+    bench_logins("login cold", 500, false, {});
+    boost::asio::thread_pool workers;
+    bench_logins("login offload", 500, false, workers.get_executor());
+
+    // one short row vs 100 rows of 16 text columns
+    auto small = pg_mock_result{{"id", "name"}}.row(42, "some customer name");
+    auto wide = pg_mock_result{{"c0", "c1", "c2", "c3", "c4", "c5", "c6", "c7", "c8", "c9", "c10", "c11", "c12", "c13", "c14", "c15"}};
+    std::string v(48, 'x');
+    for (int i = 0; i < 100; ++i) {
+        wide.row(v, v, v, v, v, v, v, v, v, v, v, v, v, v, v, v);
+    }
+    for (size_t connections : {1, 64, 1024}) {
+        bench_mock("mock small", connections, n / 10, "SELECT id, name FROM accounts WHERE id = 42", small);
+    }
+    for (size_t connections : {1, 64, 1024}) {
+        bench_mock("mock wide", connections, n / 100, "SELECT * FROM wide LIMIT 100", wide);
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// HdrHistogram layout: values in [1, highest] are kept with significant_digits decimal digits of precision
+// every bucket covers twice the range of the previous one, its sub buckets split it linearly,
+// so recording is a few shifts and an increment and the memory does not depend on the number of values
+// https://github.com/HdrHistogram/HdrHistogram
+struct hdr_histogram {
+    int64_t highest;
+    int significant_digits;
+    int unit_magnitude{};
+    int sub_bucket_half_count_magnitude;
+    int64_t sub_bucket_count;
+    int64_t sub_bucket_half_count;
+    int64_t sub_bucket_mask;
+    int bucket_count{1};
+    std::vector<int64_t> counts;
+    int64_t total{};
+    int64_t min_value{std::numeric_limits<int64_t>::max()};
+    int64_t max_value{};
+
+    hdr_histogram(int64_t highest = 3'600'000'000, int significant_digits = 3)
+        : highest{highest}, significant_digits{significant_digits} {
+        // smallest power of two that holds 2 * 10^digits, so a sub bucket is 1/10^digits of its value at most
+        int64_t largest_single_unit = 2 * (int64_t)std::pow(10, significant_digits);
+        auto sub_bucket_count_magnitude = (int)std::bit_width((uint64_t)largest_single_unit - 1);
+        sub_bucket_half_count_magnitude = std::max(sub_bucket_count_magnitude, 1) - 1;
+        sub_bucket_count = 1ll << (sub_bucket_half_count_magnitude + 1);
+        sub_bucket_half_count = sub_bucket_count / 2;
+        sub_bucket_mask = (sub_bucket_count - 1) << unit_magnitude;
+        for (auto smallest_untrackable = sub_bucket_count << unit_magnitude; smallest_untrackable <= highest; ++bucket_count) {
+            if (smallest_untrackable > std::numeric_limits<int64_t>::max() / 2) {
+                ++bucket_count;
+                break;
+            }
+            smallest_untrackable <<= 1;
+        }
+        counts.resize((bucket_count + 1) * sub_bucket_half_count);
+    }
+
+    // values above highest are counted as highest, nothing is lost
+    void record(int64_t v, int64_t n = 1) {
+        v = std::clamp<int64_t>(v, 0, highest);
+        counts[index_of(v)] += n;
+        total += n;
+        min_value = std::min(min_value, v);
+        max_value = std::max(max_value, v);
+    }
+    // histograms of the same layout, e.g. one per thread
+    void add(const hdr_histogram &h) {
+        if (h.counts.size() != counts.size()) {
+            throw std::runtime_error{"histograms of different layouts"};
+        }
+        for (size_t i = 0; i < counts.size(); ++i) {
+            counts[i] += h.counts[i];
+        }
+        total += h.total;
+        min_value = std::min(min_value, h.min_value);
+        max_value = std::max(max_value, h.max_value);
+    }
+    void reset() {
+        std::ranges::fill(counts, 0);
+        total = 0;
+        min_value = std::numeric_limits<int64_t>::max();
+        max_value = 0;
+    }
+
+    int bucket_index(int64_t v) const {
+        auto pow2ceiling = 64 - std::countl_zero((uint64_t)(v | sub_bucket_mask));
+        return pow2ceiling - unit_magnitude - (sub_bucket_half_count_magnitude + 1);
+    }
+    int64_t sub_bucket_index(int64_t v, int bucket) const {
+        return v >> (bucket + unit_magnitude);
+    }
+    size_t index_of(int64_t v) const {
+        auto b = bucket_index(v);
+        return ((int64_t)(b + 1) << sub_bucket_half_count_magnitude) + (sub_bucket_index(v, b) - sub_bucket_half_count);
+    }
+    int64_t value_at_index(size_t i) const {
+        int64_t b = (i >> sub_bucket_half_count_magnitude) - 1;
+        int64_t sb = (i & (sub_bucket_half_count - 1)) + sub_bucket_half_count;
+        if (b < 0) {
+            sb -= sub_bucket_half_count;
+            b = 0;
+        }
+        return sb << (b + unit_magnitude);
+    }
+    // values in the range of v are counted as one
+    int64_t lowest_equivalent(int64_t v) const {
+        auto b = bucket_index(v);
+        return sub_bucket_index(v, b) << (b + unit_magnitude);
+    }
+    int64_t equivalent_range(int64_t v) const {
+        auto b = bucket_index(v);
+        return 1ll << (unit_magnitude + (sub_bucket_index(v, b) >= sub_bucket_count ? b + 1 : b));
+    }
+    int64_t highest_equivalent(int64_t v) const {
+        return lowest_equivalent(v) + equivalent_range(v) - 1;
+    }
+    int64_t median_equivalent(int64_t v) const {
+        return lowest_equivalent(v) + equivalent_range(v) / 2;
+    }
+
+    auto count() const {return total;}
+    auto min() const {return total ? min_value : 0;}
+    auto max() const {return total ? highest_equivalent(max_value) : 0;}
+    // percentile in [0, 100], the highest value equivalent to the one at that rank
+    int64_t value_at_percentile(double percentile) const {
+        auto rank = std::max<int64_t>((int64_t)(std::min(percentile, 100.0) / 100 * total + 0.5), 1);
+        int64_t n{};
+        for (size_t i = 0; i < counts.size(); ++i) {
+            n += counts[i];
+            if (n >= rank) {
+                return highest_equivalent(value_at_index(i));
+            }
+        }
+        return 0;
+    }
+    double mean() const {
+        double sum{};
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i]) {
+                sum += (double)median_equivalent(value_at_index(i)) * counts[i];
+            }
+        }
+        return total ? sum / total : 0;
+    }
+    double stddev() const {
+        auto m = mean();
+        double sum{};
+        for (size_t i = 0; i < counts.size(); ++i) {
+            if (counts[i]) {
+                auto d = median_equivalent(value_at_index(i)) - m;
+                sum += d * d * counts[i];
+            }
+        }
+        return total ? std::sqrt(sum / total) : 0;
+    }
+
+    // the text format of HdrHistogram's outputPercentileDistribution, values divided by scale
+    // (e.g. 1000 for microseconds shown as milliseconds), percentile steps halve
+    // ticks_per_half_distance times every time the distance to 100% halves
+    std::string percentile_distribution(double scale = 1, int ticks_per_half_distance = 5) const {
+        std::string s;
+        s += std::format("{:>12} {:>14} {:>10} {:>14}\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+        if (!total) {
+            return s;
+        }
+        double percentile{};
+        while (1) {
+            auto v = value_at_percentile(percentile);
+            int64_t n{};
+            for (size_t i = 0; i < counts.size() && value_at_index(i) <= v; ++i) {
+                n += counts[i];
+            }
+            if (n >= total) {
+                break;
+            }
+            s += std::format("{:12.3f} {:1.12f} {:10} {:14.2f}\n", v / scale, percentile / 100, n, 1 / (1 - percentile / 100));
+            auto ticks = ticks_per_half_distance * std::pow(2, std::floor(std::log2(100 / (100 - percentile))) + 1);
+            percentile += 100 / ticks;
+        }
+        s += std::format("{:12.3f} {:1.12f} {:10}\n", max() / scale, 1.0, total);
+        s += std::format("#[Mean    = {:12.3f}, StdDeviation   = {:12.3f}]\n", mean() / scale, stddev() / scale);
+        s += std::format("#[Max     = {:12.3f}, Total count    = {:12}]\n", max() / scale, total);
+        s += std::format("#[Buckets = {:12}, SubBuckets     = {:12}]\n", bucket_count, sub_bucket_count);
+        return s;
+    }
+};
@@ -0,0 +1,301 @@
+#include "hdr_histogram.h"
+#include "pg_mock_server.h"
+#include "pg_runtime.h"
+
+#include <random>
+
+// pgbench-like load generator: clients run a weighted mix of queries over a pg_sharded_pool
+//   pg_client_loadgen --connstr="host=db user=u password=p dbname=d" --threads=4 --connections=32 --clients=64
+//       --duration=30 --rate=20000 --pipeline=1
+//       --query="10:SELECT abalance FROM pgbench_accounts WHERE aid = {random 1 100000}"
+//       --query="1:UPDATE pgbench_accounts SET abalance = abalance + 1 WHERE aid = {random 1 100000}"
+// with --rate every client sends on a fixed schedule and a latency is measured from when the query
+// was due, not from when it could be sent, so a stall is not hidden by the queries it held back
+// (coordinated omission); without it clients run closed loop with --think ms between queries
+// --mock runs against the in-process mock backend instead of --connstr, every query returns one row
+// --metrics prints the client metrics (pg_metrics) in Prometheus text format at the end
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+    std::string connstr;
+    size_t threads{1};
+    // over all threads
+    size_t connections{8};
+    // concurrent clients, 0 - one per connection; more clients than connections queue in the pool
+    size_t clients{};
+    double duration{10};
+    // seconds at the start that are not recorded
+    double warmup{};
+    // queries per second over all clients, 0 - closed loop
+    double rate{};
+    // statements sent with one sync
+    size_t pipeline{1};
+    // ms between queries of a client in closed loop
+    double think{};
+    std::vector<std::string> queries;
+    bool mock{};
+    bool metrics{};
+};
+
+// weight:text, {random lo hi} in the text is a parameter, a uniform random integer per execution
+struct mix_query {
+    size_t weight{1};
+    std::string text;
+    std::vector<std::uniform_int_distribution<int64_t>> params;
+
+    static mix_query parse(std::string_view s) {
+        mix_query q;
+        if (auto p = s.find(':'); p != -1 && p && s.substr(0, p).find_first_not_of("0123456789") == -1) {
+            q.weight = std::stoull(std::string{s.substr(0, p)});
+            s.remove_prefix(p + 1);
+        }
+        while (1) {
+            auto p = s.find("{random ");
+            if (p == -1) {
+                q.text += s;
+                break;
+            }
+            auto e = s.find('}', p);
+            if (e == -1) {
+                throw std::runtime_error{"unterminated {random lo hi} in: "s + std::string{s}};
+            }
+            auto range = split_string(std::string{s.substr(p, e - p)}, " ");
+            if (range.size() != 3) {
+                throw std::runtime_error{"expected {random lo hi} in: "s + std::string{s}};
+            }
+            q.params.emplace_back(std::stoll(range[1]), std::stoll(range[2]));
+            q.text += s.substr(0, p);
+            q.text += "$" + std::to_string(q.params.size());
+            s.remove_prefix(e + 1);
+        }
+        return q;
+    }
+};
+
+// every shard records into its own, they are added up at the end
+struct shard_stats {
+    // microseconds
+    hdr_histogram latency;
+    // all counted per statement
+    int64_t queries{};
+    // the server returned an error
+    int64_t errors{};
+    // i/o and client errors, the connection is dropped
+    int64_t failures{};
+    clock_type::time_point last{};
+};
+
+struct load {
+    options opts;
+    std::vector<mix_query> mix;
+    std::discrete_distribution<size_t> pick;
+    std::vector<shard_stats> stats;
+    clock_type::time_point start;
+    clock_type::time_point recording;
+    clock_type::time_point end;
+
+    task<> client(pg_pool &pool, size_t id) {
+        auto &st = stats[pg_runtime::current];
+        auto clients = opts.clients;
+        std::mt19937_64 rng{id};
+        auto pick = this->pick;
+        auto mix = this->mix;
+        boost::asio::steady_timer timer{co_await boost::asio::this_coro::executor};
+        auto us = [](auto d) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        };
+        // schedule of this client, clients are spread over the first interval
+        auto interval = opts.rate ? std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(clients * opts.pipeline / opts.rate)) : clock_type::duration{};
+        auto think = std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double, std::milli>(opts.think));
+        auto next = start + interval * id / clients;
+        pg_pipeline p;
+        while (1) {
+            auto due = clock_type::now();
+            if (opts.rate) {
+                due = next;
+                next += interval;
+                timer.expires_at(due);
+                co_await timer.async_wait(boost::asio::use_awaitable);
+            }
+            if (due >= end) {
+                break;
+            }
+            p.clear();
+            for (size_t i = 0; i < opts.pipeline; ++i) {
+                auto &q = mix[pick(rng)];
+                auto &s = p.statements.emplace_back(q.text);
+                for (auto &&d : q.params) {
+                    s.params.emplace_back(std::to_string(d(rng)));
+                }
+            }
+            // waiting for a connection is part of the latency
+            std::exception_ptr ep;
+            bool failed{};
+            pg_pool::lease conn;
+            try {
+                // opening a new connection for the pool fails like a query does
+                conn = co_await pool.acquire();
+                failed = !co_await conn->try_run(p);
+            } catch (std::exception &) {
+                ep = std::current_exception();
+                if (conn) {
+                    conn->s.close();
+                }
+            }
+            conn.release();
+            auto now = clock_type::now();
+            st.last = std::max(st.last, now);
+            if (due >= recording) {
+                // the statements of a pipeline share one implicit transaction, an error rolls all of them back
+                st.queries += opts.pipeline;
+                st.errors += failed ? opts.pipeline : 0;
+                st.failures += ep ? opts.pipeline : 0;
+                // with --rate the latency already counts from when the query was due, the time it was
+                // held back included; a closed loop has no schedule to correct against
+                st.latency.record(us(now - due), opts.pipeline);
+            }
+            if (!opts.rate && think.count()) {
+                timer.expires_after(think);
+                co_await timer.async_wait(boost::asio::use_awaitable);
+            }
+        }
+    }
+};
+
+options parse_options(int argc, char *argv[]) {
+    options o;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        auto p = a.find('=');
+        auto name = a.substr(0, p);
+        auto value = p == -1 ? ""s : std::string{a.substr(p + 1)};
+        if (name == "--connstr") {
+            o.connstr = value;
+        } else if (name == "--threads") {
+            o.threads = std::stoull(value);
+        } else if (name == "--connections") {
+            o.connections = std::stoull(value);
+        } else if (name == "--clients") {
+            o.clients = std::stoull(value);
+        } else if (name == "--duration") {
+            o.duration = std::stod(value);
+        } else if (name == "--warmup") {
+            o.warmup = std::stod(value);
+        } else if (name == "--rate") {
+            o.rate = std::stod(value);
+        } else if (name == "--pipeline") {
+            o.pipeline = std::max<size_t>(std::stoull(value), 1);
+        } else if (name == "--think") {
+            o.think = std::stod(value);
+        } else if (name == "--query") {
+            o.queries.push_back(value);
+        } else if (name == "--mock") {
+            o.mock = true;
+        } else if (name == "--metrics") {
+            o.metrics = true;
+        } else {
+            throw std::runtime_error{"unknown option: "s + std::string{a}};
+        }
+    }
+    o.threads = std::max<size_t>(o.threads, 1);
+    o.connections = std::max(o.connections, o.threads);
+    if (!o.clients) {
+        o.clients = o.connections;
+    }
+    if (o.queries.empty()) {
+        // pgbench --select-only
+        o.queries.push_back("SELECT abalance FROM pgbench_accounts WHERE aid = {random 1 100000}");
+    }
+    if (o.connstr.empty() && !o.mock) {
+        throw std::runtime_error{"--connstr or --mock is required"};
+    }
+    return o;
+}
+
+int main(int argc, char *argv[]) {
+    load l{parse_options(argc, argv)};
+    auto &opts = l.opts;
+    std::vector<size_t> weights;
+    for (auto &&q : opts.queries) {
+        l.mix.push_back(mix_query::parse(q));
+        weights.push_back(l.mix.back().weight);
+    }
+    l.pick = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+
+    // the mock backend gets a thread of its own
+    boost::asio::io_context mock_ctx;
+    std::optional<pg_mock_server> mock;
+    std::thread mock_thread;
+    if (opts.mock) {
+        mock.emplace(mock_ctx, "loadgen");
+        for (auto &&q : l.mix) {
+            mock->on(q.text, pg_mock_result{{"v"}}.row(1));
+        }
+        mock->start();
+        mock_thread = std::thread{[&] {
+            mock_ctx.run();
+        }};
+        opts.connstr = mock->connection_string("loadgen");
+    }
+
+    pg_runtime rt{opts.threads};
+    // every connection is opened before the run
+    auto per_shard = (opts.connections + opts.threads - 1) / opts.threads;
+    pg_sharded_pool pool{rt, opts.connstr, {.min_size = per_shard, .max_size = per_shard}};
+    l.stats.resize(rt.size());
+    rt.start();
+    pool.start();
+
+    l.start = clock_type::now();
+    l.recording = l.start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(opts.warmup));
+    l.end = l.recording + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(opts.duration));
+    std::vector<std::future<void>> clients;
+    for (size_t i = 0; i < opts.clients; ++i) {
+        clients.emplace_back(pool.spawn([&l, i](pg_pool &p) {
+            return l.client(p, i);
+        }, boost::asio::use_future));
+    }
+    for (auto &&c : clients) {
+        c.get();
+    }
+    pool.stop();
+    rt.stop();
+    rt.join();
+    if (mock) {
+        boost::asio::post(mock_ctx, [&] {
+            mock->stop();
+        });
+    }
+
+    shard_stats total;
+    for (auto &&s : l.stats) {
+        total.latency.add(s.latency);
+        total.queries += s.queries;
+        total.errors += s.errors;
+        total.failures += s.failures;
+        total.last = std::max(total.last, s.last);
+    }
+    auto d = std::chrono::duration<double>(std::max(total.last, l.end) - l.recording).count();
+    auto &h = total.latency;
+    auto ms = [&](double p) {
+        return h.value_at_percentile(p) / 1000.0;
+    };
+    std::cout << std::format("{} clients on {} threads, {} connections, pipeline {}, {}\n", opts.clients, rt.size(),
+        per_shard * rt.size(), opts.pipeline,
+        opts.rate ? std::format("rate {:.0f}/s", opts.rate) : std::format("closed loop, think {}ms", opts.think));
+    std::cout << std::format("{} queries, {} errors, {} failures in {:.3f}s, {:.0f} queries/s\n",
+        total.queries, total.errors, total.failures, d, total.queries / d);
+    std::cout << std::format("latency ms: p50 {:.3f} p90 {:.3f} p99 {:.3f} p99.9 {:.3f} p99.99 {:.3f} max {:.3f}\n\n",
+        ms(50), ms(90), ms(99), ms(99.9), ms(99.99), h.max() / 1000.0);
+    std::cout << h.percentile_distribution(1000);
+    if (opts.metrics) {
+        std::cout << "\n" << pg_metrics::instance().snapshot().prometheus();
+    }
+
+    // the pool closes its connections, then the mock sessions end
+    if (mock) {
+        pool.pools.clear();
+        mock_thread.join();
+    }
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "pg_connection.h"
+
+#include <atomic>
+#include <chrono>
+
+// every allocation of the process is counted, a benchmark reports the ones made while it runs
+std::atomic<size_t> allocations;
+std::atomic<size_t> allocated_bytes;
+
+void *operator new(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(n, std::memory_order_relaxed);
+    if (auto p = malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void *p) noexcept {
+    free(p);
+}
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+struct bench_run {
+    std::string_view name;
+    size_t n;
+    size_t allocations_at_start;
+    size_t bytes_at_start;
+    bench_clock::time_point start;
+
+    bench_run(std::string_view name, size_t n)
+        : name{name}, n{n}, allocations_at_start{allocations}, bytes_at_start{allocated_bytes}, start{bench_clock::now()} {
+    }
+    ~bench_run() {
+        auto d = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+        std::cout << std::format("{:28} {:10.1f} ns/op {:8.2f} allocs/op {:10.1f} bytes/op\n", name, d / n,
+            (double)(allocations - allocations_at_start) / n, (double)(allocated_bytes - bytes_at_start) / n);
+    }
+};
+
+// runs f n times after a short warm up
+void bench(std::string_view name, size_t n, auto &&f) {
+    for (size_t i = 0; i < std::min<size_t>(n / 10, 1000); ++i) {
+        f();
+    }
+    bench_run r{name, n};
+    for (size_t i = 0; i < n; ++i) {
+        f();
+    }
+}
+// same for a coroutine, the loop runs inside ctx, it has to be the one of the sockets f uses
+void bench_async(boost::asio::io_context &ctx, std::string_view name, size_t n, auto &&f) {
+    ctx.restart();
+    boost::asio::co_spawn(ctx, [&]() -> task<> {
+        for (size_t i = 0; i < std::min<size_t>(n / 10, 1000); ++i) {
+            co_await f();
+        }
+        bench_run r{name, n};
+        for (size_t i = 0; i < n; ++i) {
+            co_await f();
+        }
+    }, [](std::exception_ptr e) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    });
+    ctx.run();
+}
+
+// a socket that always has data ready, it replays the same whole messages over and over
+struct memory_stream {
+    std::string_view data;
+    size_t pos{};
+
+    task<size_t> async_read_some(boost::asio::mutable_buffer b, auto &&) {
+        auto n = std::min(b.size(), data.size() - pos);
+        memcpy(b.data(), data.data() + pos, n);
+        pos = (pos + n) % data.size();
+        co_return n;
+    }
+};
+
+// backend message with the header in front of the body
+std::string make_message(char type, std::string_view body) {
+    std::string m;
+    m += type;
+    pg_append_be(m, (i32)(sizeof(i32) + body.size()));
+    m += body;
+    return m;
+}
+
+struct row {
+    i32 id;
+    int64_t balance;
+    std::string_view name;
+};
+
+// binary data row of a row
+std::string make_data_row() {
+    std::string body;
+    pg_append_be(body, (i16)3);
+    pg_encode_field(body, (i32)42);
+    pg_encode_field(body, (int64_t)1'000'000);
+    pg_encode_field(body, "some customer name"sv);
+    return make_message(message_type<data_row>, body);
+}
+
+std::string make_error() {
+    std::string body;
+    auto add = [&](char code, std::string_view v) {
+        body += code;
+        body += v;
+        body += '\0';
+    };
+    add('S', "ERROR");
+    add('V', "ERROR");
+    add('C', "23505");
+    add('M', "duplicate key value violates unique constraint \"accounts_pkey\"");
+    add('D', "Key (id)=(42) already exists.");
+    add('s', "public");
+    add('t', "accounts");
+    add('n', "accounts_pkey");
+    add('F', "nbtinsert.c");
+    add('L', "666");
+    add('R', "_bt_check_unique");
+    body += '\0';
+    return make_message(message_type<error_response>, body);
+}
+
+// what a server sends during SCRAM-SHA-256 for the (fixed) client nonce of pg_connection::auth
+std::string make_scram_replies(const std::string &password, int iterations) {
+    using namespace crypto;
+    std::string salt = "saltsaltsalt";
+    auto keys = scram_keys::derive(password, salt, iterations);
+    std::string r(18, '0');
+    auto user_data = "n=,r=" + base64::encode(r);
+    auto nonce = base64::encode(r) + "srvnonce";
+    auto server_first = std::format("r={},s={},i={}", nonce, base64::encode(salt), iterations);
+    auto client_final = "c=" + base64::encode("n,,"s) + ",r=" + nonce;
+    auto auth_message = user_data + "," + server_first + "," + client_final;
+    auto server_signature = hmac<sha256>(keys.server_key, auth_message);
+
+    std::string replies;
+    auto add = [&](i32 auth_type, std::string_view data) {
+        std::string body;
+        pg_append_be(body, auth_type);
+        body += data;
+        replies += make_message('R', body);
+    };
+    add(authentication_sasl::auth_type, "SCRAM-SHA-256\0\0"sv);
+    add(authentication_sasl_continue::auth_type, server_first);
+    add(authentication_sasl_final::auth_type, "v=" + base64::encode(server_signature));
+    add(authentication_ok::auth_type, {});
+    return replies;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n = argc > 1 ? std::stoull(argv[1]) : 1'000'000;
+    boost::asio::io_context ctx;
+    pg_connection c{ctx, "user=bench password=bench"};
+
+    // serialization
+    pg_pipeline::statement st{"SELECT id, balance, name FROM accounts WHERE id = $1 AND name = $2;", {"42", "some customer name"}, 1};
+    bench("append_query (bind/execute)", n, [&] {
+        c.append_query(st, "s1", false);
+        c.output.clear();
+    });
+    bench("append_query (prepare)", n, [&] {
+        c.append_query(st, "s1", true);
+        c.output.clear();
+    });
+    bench("append_message<query>", n, [&] {
+        c.append_message<struct query>("SELECT 1;"sv);
+        c.output.clear();
+    });
+
+    // framing
+    std::string rows;
+    for (int i = 0; i < 1000; ++i) {
+        rows += make_data_row();
+    }
+    memory_stream ms{rows};
+    receive_buffer input;
+    bench_async(ctx, "get_message (data_row)", n, [&]() -> task<> {
+        co_await input.get_message(ms);
+    });
+
+    // decoding
+    auto error = make_error();
+    bench("pg_error_fields", n, [&] {
+        auto e = pg_error_fields(message_view::from({(const i8 *)error.data(), error.size()}));
+        if (e.code.empty()) {
+            throw std::runtime_error{"no code"};
+        }
+    });
+    bench("pg_error (copy of message)", n, [&] {
+        pg_error e{message_view::from({(const i8 *)error.data(), error.size()})};
+    });
+    auto dr = make_data_row();
+    auto drm = message_view::from({(const i8 *)dr.data(), dr.size()});
+    int64_t sum{};
+    bench("pg_decode_row<row>", n, [&] {
+        sum += pg_decode_row<row>(drm).balance;
+    });
+    bench("row_ref column 2", n, [&] {
+        sum += row_ref{drm}[2].size();
+    });
+    bench("pg_message_decoder<data_row>", n, [&] {
+        for (auto &&v : pg_message_decoder<data_row>::decode(drm).elements) {
+            sum += v.the_value_of_the_column_in_the_format_indicated_by_the_associated_format_code->size();
+        }
+    });
+
+    // auth, the keys come from the process-wide cache after the first run like on a reconnect
+    constexpr auto iterations = 4096;
+    auto replies = make_scram_replies(c.params["password"], iterations);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    boost::asio::local::stream_protocol::socket client_side{ctx}, server{ctx};
+    boost::asio::local::connect_pair(client_side, server);
+    pg_connection::socket_type client{ctx, boost::asio::generic::stream_protocol{AF_UNIX, 0}, client_side.release()};
+    std::vector<char> sink(64 * 1024);
+    bench_async(ctx, "auth (scram-sha-256, cached)", std::max<size_t>(n / 100, 1), [&]() -> task<> {
+        boost::asio::write(server, boost::asio::buffer(replies));
+        co_await c.auth(client);
+        // what the client sent
+        while (server.available()) {
+            server.read_some(boost::asio::buffer(sink));
+        }
+    });
+#endif
+
+    // keeps the decoding from being optimized out
+    static volatile int64_t result;
+    result = sum;
+    return 0;
+}
@@ -0,0 +1,1461 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <primitives/sw/main.h>
+#include <primitives/templates2/base64.h>
+#include <primitives/templates2/overload.h>
+#include <hmac.h>
+
+#include <chrono>
+#include <expected>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <stdint.h>
+
+namespace ip = boost::asio::ip;
+
+template <typename T = void>
+using task = boost::asio::awaitable<T>;
+
+#include "pg_messages.h"
+#include "pg_types.h"
+#include "pg_message_dispatch.h"
+#include "pg_message_encoders.h"
+#include "pg_message_decoders.h"
+#include "pg_metrics.h"
+
+// reads as much as the socket has ready and frames every complete message
+// already in the buffer without going back to the kernel
+// messages are kept contiguous (get<T>() casts over them), so instead of wrapping around
+// the unread tail is moved to the front when the next message does not fit
+struct receive_buffer {
+    static constexpr inline size_t default_capacity = 64 * 1024;
+    // the length comes from the server, a corrupt or hostile one must not make the buffer grow without bound
+    static constexpr inline size_t default_max_message_size = 256 * 1024 * 1024;
+
+    std::vector<i8> buf;
+    size_t begin{};
+    size_t end{};
+    size_t max_message_size{default_max_message_size};
+
+    receive_buffer(size_t capacity = default_capacity) : buf(capacity) {}
+
+    auto data() const {return buf.data() + begin;}
+    auto size() const {return end - begin;}
+
+    // full size of the next message (type byte included) or header size if it is not known yet
+    size_t next_message_size() const {
+        if (size() < sizeof(header)) {
+            return sizeof(header);
+        }
+        header h;
+        memcpy(&h, data(), sizeof(h));
+        if (h.length < (i32)sizeof(h.length) || (size_t)h.length > max_message_size) {
+            throw std::runtime_error{"bad message length: "s + std::to_string(h.length)};
+        }
+        return sizeof(h.type) + h.length;
+    }
+    task<> fill(auto &s, size_t want) {
+        if (begin == end) {
+            begin = end = 0;
+        } else if (buf.size() - begin < want) {
+            memmove(buf.data(), data(), size());
+            end -= begin;
+            begin = 0;
+        }
+        if (buf.size() < want) {
+            buf.resize(want);
+        }
+        end += co_await s.async_read_some(boost::asio::buffer(buf.data() + end, buf.size() - end), boost::asio::use_awaitable);
+    }
+    // the view stays valid until the next call, the buffer is only compacted or grown in fill()
+    task<message_view> get_message(auto &s) {
+        size_t sz;
+        while (size() < (sz = next_message_size())) {
+            co_await fill(s, sz);
+        }
+        message_view m;
+        memcpy(&m.h, data(), sizeof(header));
+        m.data = {data(), sz};
+        begin += sz;
+        co_return m;
+    }
+};
+
+// fields of an error_response (or a notice_response) by their codes, they point into the message
+// https://www.postgresql.org/docs/current/protocol-error-fields.html
+template <typename Type = error_response>
+error_response::error1 pg_error_fields(const message_view &m) {
+    error_response::error1 e;
+    for (auto &&f : pg_message_decoder<Type>::decode(m).elements) {
+        auto sv = f.the_field_value;
+        switch (f.a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows) {
+            case 'S': e.severity_localized = sv; break;
+            case 'V': e.severity = sv; break;
+            case 'C': e.code = sv; break;
+            case 'M': e.message = sv; break;
+            case 'D': e.detail = sv; break;
+            case 'H': e.hint = sv; break;
+            case 'P': e.position = sv; break;
+            case 'p': e.internal_position = sv; break;
+            case 'q': e.internal_query = sv; break;
+            case 'W': e.where = sv; break;
+            case 's': e.schema = sv; break;
+            case 't': e.table = sv; break;
+            case 'c': e.column = sv; break;
+            case 'd': e.data_type = sv; break;
+            case 'n': e.constraint = sv; break;
+            case 'F': e.file = sv; break;
+            case 'L': e.line = sv; break;
+            case 'R': e.routine = sv; break;
+            default: break;
+        }
+    }
+    return e;
+}
+
+// error_response of the server, keeps the message, fields point into it
+struct pg_error {
+    std::vector<i8> data;
+    error_response::error1 fields;
+
+    pg_error(const message_view &m) : data(m.data.begin(), m.data.end()), fields{parse()} {}
+    pg_error(const pg_error &rhs) : data{rhs.data}, fields{parse()} {}
+    // moving the vector keeps its buffer
+    pg_error(pg_error &&) = default;
+    pg_error &operator=(const pg_error &rhs) {
+        data = rhs.data;
+        fields = parse();
+        return *this;
+    }
+    pg_error &operator=(pg_error &&) = default;
+
+    // five characters, e.g. 23505 unique_violation, 40001 serialization_failure
+    auto sqlstate() const {return fields.code;}
+    auto message() const {return fields.message;}
+    auto format() const {return fields.format();}
+    error_response::error1 parse() const {
+        return pg_error_fields(message_view::from(data));
+    }
+};
+// errors of the server come as values, nothing is thrown or formatted for them
+// client side and i/o errors are still thrown
+template <typename T>
+using pg_expected = std::expected<T, pg_error>;
+
+// rows of one statement, data rows are kept back to back in one buffer
+struct pg_result {
+    std::vector<i8> description;
+    std::vector<i8> data;
+    std::vector<size_t> offsets;
+    std::string command_tag;
+    // the portal stopped at the execute row limit and can be resumed
+    bool suspended{};
+
+    auto size() const {return offsets.size();}
+    auto empty() const {return offsets.empty();}
+    // row_description elements, validated on every call
+    pg_list<pg_message_decoder<row_description>::element> fields() const {
+        if (description.empty()) {
+            return {};
+        }
+        return pg_message_decoder<row_description>::decode(message_view::from(description)).elements;
+    }
+    message_view operator[](size_t i) const {
+        message_view m;
+        memcpy(&m.h, data.data() + offsets[i], sizeof(header));
+        m.data = {data.data() + offsets[i], sizeof(m.h.type) + m.h.length};
+        return m;
+    }
+
+    // returns true when the statement is complete
+    bool add(const message_view &m) {
+        return visit_backend(m, overload([&](const data_row *) {
+            offsets.push_back(data.size());
+            data.insert(data.end(), m.data.begin(), m.data.end());
+            return false;
+        }, [&](const row_description *) {
+            description.assign(m.data.begin(), m.data.end());
+            return false;
+        }, [&](const command_complete *) {
+            command_tag = pg_message_decoder<command_complete>::decode(m).the_command_tag;
+            return true;
+        }, [](const empty_query_response *) {
+            return true;
+        }, [&](const portal_suspended *) {
+            suspended = true;
+            return true;
+        }, [&](const auto &) -> bool {
+            throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+        }));
+    }
+};
+
+// statements queued to be sent together with a single Sync
+struct pg_pipeline {
+    // text format parameter value, std::nullopt is NULL
+    using parameter = std::optional<std::string>;
+
+    struct statement {
+        std::string query;
+        std::vector<parameter> params;
+        // 0 - text, 1 - binary for all result columns
+        i16 result_format{};
+    };
+    std::vector<statement> statements;
+
+    void query(std::string_view q, auto && ... args) {
+        auto &st = statements.emplace_back(std::string{q});
+        st.params.reserve(sizeof...(args));
+        (st.params.emplace_back(to_parameter(args)),...);
+    }
+    auto size() const {return statements.size();}
+    auto empty() const {return statements.empty();}
+    void clear() {statements.clear();}
+
+    static parameter to_parameter(const auto &v) {
+        using T = std::decay_t<decltype(v)>;
+        if constexpr (std::is_same_v<T, std::nullopt_t>) {
+            return {};
+        } else if constexpr (requires {v.has_value(); *v;}) {
+            return v ? to_parameter(*v) : parameter{};
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return v ? "t"s : "f"s;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            return std::format("{}", v);
+        } else {
+            return std::string{v};
+        }
+    }
+};
+
+// named prepared statements keyed by query text, least recently used are closed first
+struct statement_cache {
+    static constexpr inline size_t default_capacity = 256;
+
+    struct entry {
+        std::string query;
+        std::string name;
+        // parameter_description and row_description (empty for no_data) from Describe
+        std::vector<i8> parameter_description;
+        std::vector<i8> row_description;
+        // set on parse_complete, entries not prepared by the server are removed after errors
+        bool prepared{};
+    };
+    using iterator = std::list<entry>::iterator;
+
+    size_t capacity{default_capacity};
+    uint64_t next_id{};
+    // most recently used first
+    std::list<entry> entries;
+    std::unordered_map<std::string_view, iterator> index;
+    // evicted entries to be closed with the next pipeline and those waiting for close_complete
+    // they are kept alive until then because results of the pipeline may still refer to them
+    std::list<entry> evicted;
+    std::list<entry> closing;
+
+    // returns the entry and whether it was already there
+    std::pair<entry *, bool> get(std::string_view q) {
+        if (auto i = index.find(q); i != index.end()) {
+            entries.splice(entries.begin(), entries, i->second);
+            return {&*i->second, true};
+        }
+        if (entries.size() == capacity) {
+            index.erase(entries.back().query);
+            evicted.splice(evicted.end(), entries, std::prev(entries.end()));
+        }
+        auto &e = entries.emplace_front(std::string{q}, "s" + std::to_string(++next_id));
+        index.emplace(e.query, entries.begin());
+        return {&e, false};
+    }
+    // after an error the server skipped the rest of the pipeline
+    void rollback() {
+        for (auto i = entries.begin(); i != entries.end();) {
+            if (i->prepared) {
+                ++i;
+                continue;
+            }
+            index.erase(i->query);
+            i = entries.erase(i);
+        }
+        evicted.splice(evicted.begin(), closing);
+    }
+};
+
+// SCRAM-SHA-256 keys derived from the password, they stay the same for every connection of a user
+// until the server changes the salt or the iteration count
+struct scram_keys {
+    using key = decltype(crypto::pbkdf2<crypto::sha256>(std::string{}, std::string{}, 1));
+
+    key salted_password;
+    key client_key;
+    key server_key;
+
+    static scram_keys derive(const std::string &password, const std::string &salt, int iterations) {
+        using namespace crypto;
+        scram_keys k;
+        k.salted_password = pbkdf2<sha256>(password, salt, iterations);
+        k.client_key = hmac<sha256>(k.salted_password, "Client Key"sv);
+        k.server_key = hmac<sha256>(k.salted_password, "Server Key"sv);
+        return k;
+    }
+};
+
+// process-wide, so reconnects and pool growth skip pbkdf2 (milliseconds of cpu per connection)
+// the password is kept only as its hash
+struct scram_key_cache {
+    // user, password hash, salt, iterations
+    using key = std::tuple<std::string, std::string, std::string, int>;
+
+    static constexpr inline size_t max_size = 1024;
+
+    std::mutex m;
+    std::map<key, scram_keys> keys;
+
+    static scram_key_cache &instance() {
+        static scram_key_cache c;
+        return c;
+    }
+
+    // derives the keys on a miss, pbkdf2 runs outside of the lock
+    // and on ex when it is set, so a burst of new connections does not stall the caller's event loop
+    task<scram_keys> get(const std::string &user, const std::string &password, const std::string &salt, int iterations,
+        boost::asio::any_io_executor ex = {}) {
+        auto h = crypto::sha256::digest(password);
+        key k{user, std::string{(const char *)h.data(), h.size()}, salt, iterations};
+        {
+            std::lock_guard lk{m};
+            if (auto i = keys.find(k); i != keys.end()) {
+                co_return i->second;
+            }
+        }
+        scram_keys v;
+        if (ex) {
+            v = co_await boost::asio::co_spawn(ex, [&]() -> task<scram_keys> {
+                co_return scram_keys::derive(password, salt, iterations);
+            }, boost::asio::use_awaitable);
+        } else {
+            v = scram_keys::derive(password, salt, iterations);
+        }
+        std::lock_guard lk{m};
+        if (keys.size() >= max_size) {
+            keys.clear();
+        }
+        keys.emplace(std::move(k), v);
+        co_return v;
+    }
+};
+
+struct pg_connection {
+    using socket_type = boost::asio::generic::stream_protocol::socket;
+
+    struct view_base {
+        const i8 *d;
+        size_t sz;
+
+        view_base(auto &d) : d{(const i8 *)d.data()}, sz{d.size()} {}
+
+        auto data() const {return d;}
+        auto size() const {return sz;}
+    };
+    struct zero_byte : view_base {};
+
+    // cursors and COPY leave the connection in the middle of an exchange with the server until they are done,
+    // one dropped before that abandons the connection (closes it), so a pool drops it instead of handing it out
+    struct unfinished_guard {
+        pg_connection *c;
+
+        unfinished_guard(pg_connection *c) : c{c} {}
+        unfinished_guard(unfinished_guard &&rhs) noexcept : c{std::exchange(rhs.c, nullptr)} {}
+        ~unfinished_guard() {
+            if (c) {
+                c->abandon();
+            }
+        }
+
+        void release() {
+            c = nullptr;
+        }
+    };
+
+    // COPY ... FROM STDIN in text or binary format
+    // rows and raw chunks are serialized straight into the connection output buffer as copy_data frames
+    // of up to frame_size bytes (raw chunks are split, only a single longer row makes a longer frame),
+    // a full frame is written out before more is accepted, so memory stays bounded by one frame
+    // and the producer is paced by the socket
+    struct copy_writer {
+        static constexpr inline size_t default_frame_size = 64 * 1024;
+
+        pg_connection *c;
+        // 0 - text, 1 - binary
+        i8 format;
+        size_t frame_size;
+        std::string &buf;
+        // start of the open frame in buf
+        size_t frame{};
+        unfinished_guard unfinished;
+
+        copy_writer(pg_connection *c, i8 format, size_t frame_size) : c{c}, format{format}, frame_size{frame_size}, buf{c->output}, unfinished{c} {
+            buf.reserve(frame_size + sizeof(header));
+            open_frame();
+            if (format) {
+                // signature, flags, header extension length
+                buf += "PGCOPY\n\377\r\n\0"sv;
+                pg_append_be(buf, 0);
+                pg_append_be(buf, 0);
+            }
+        }
+
+        task<> write(std::string_view chunk) {
+            while (!chunk.empty()) {
+                if (pending() >= frame_size) {
+                    co_await flush();
+                }
+                auto n = std::min(chunk.size(), frame_size - pending());
+                buf += chunk.substr(0, n);
+                chunk.remove_prefix(n);
+            }
+            if (pending() >= frame_size) {
+                co_await flush();
+            }
+        }
+        // values are encoded in the format of the COPY
+        task<> write_row(const auto & ... values) {
+            if (format) {
+                pg_append_be(buf, (i16)sizeof...(values));
+                (pg_encode_field(buf, values),...);
+            } else {
+                bool first{true};
+                auto f = [&](auto &&v) {
+                    if (!first) {
+                        buf += '\t';
+                    }
+                    first = false;
+                    append_text(v);
+                };
+                (f(values),...);
+                buf += '\n';
+            }
+            if (pending() >= frame_size) {
+                co_await flush();
+            }
+        }
+        task<> flush() {
+            close_frame();
+            co_await c->flush_output(c->s);
+            open_frame();
+        }
+        // returns the command tag (COPY n)
+        // the last frame and copy_done go out in one write
+        task<std::string> finish() {
+            unfinished.release();
+            if (format) {
+                // file trailer
+                pg_append_be(buf, (i16)-1);
+            }
+            close_frame();
+            c->append_message<copy_done>();
+            co_await c->flush_output(c->s);
+            auto results = co_await c->get_results(c->s);
+            co_return results.empty() ? ""s : results.back().command_tag;
+        }
+        task<> fail(std::string_view reason) {
+            unfinished.release();
+            // the server discards the copied data anyway
+            buf.resize(frame);
+            co_await c->send_message<copy_fail>(c->s, reason);
+            // the server confirms the failure with an error (57014)
+            co_await c->try_get_results(c->s);
+        }
+        size_t pending() const {
+            return buf.size() - frame - sizeof(header);
+        }
+        // the header is filled in by close_frame(), the frame counts as sent only then
+        void open_frame() {
+            frame = buf.size();
+            buf.append(sizeof(header), '\0');
+            buf[frame] = 'd';
+        }
+        // sets the frame length, an empty frame is dropped
+        void close_frame() {
+            if (!pending()) {
+                buf.resize(frame);
+                return;
+            }
+            be_i32 len = buf.size() - frame - sizeof(header::type);
+            memcpy(buf.data() + frame + sizeof(header::type), &len, sizeof(len));
+            c->count_sent(message_type<copy_data>);
+        }
+        void append_text(const auto &v) {
+            auto p = pg_pipeline::to_parameter(v);
+            if (!p) {
+                buf += "\\N";
+                return;
+            }
+            for (auto ch : *p) {
+                switch (ch) {
+                case '\\': buf += "\\\\"; break;
+                case '\t': buf += "\\t"; break;
+                case '\n': buf += "\\n"; break;
+                case '\r': buf += "\\r"; break;
+                default: buf += ch; break;
+                }
+            }
+        }
+    };
+
+    // COPY ... TO STDOUT, the server sends every row in its own copy_data
+    // the socket is read only when the consumer asks for the next row, so memory use
+    // does not depend on the size of the export and a slow consumer slows the server down
+    struct copy_reader {
+        pg_connection *c;
+        // 0 - text, 1 - binary
+        i8 format;
+        // from copy_out_response, every binary tuple is checked against it
+        i16 columns;
+        bool header_seen{};
+        bool done{};
+        std::string command_tag;
+        unfinished_guard unfinished{c};
+
+        // next copy_data payload, valid until the next call; std::nullopt at the end
+        task<std::optional<std::span<const i8>>> next() {
+            if (done) {
+                co_return std::nullopt;
+            }
+            std::optional<pg_error> err;
+            try {
+                auto m = co_await c->next_query_message(c->s);
+                if (message_type<copy_data> == m.h.type) {
+                    co_return m.data.subspan(sizeof(header));
+                }
+                if (message_type<error_response> == m.h.type) {
+                    err.emplace(m);
+                    c->count_error(err->sqlstate());
+                } else if (message_type<copy_done> != m.h.type) {
+                    throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+                }
+            } catch (...) {
+                done = true;
+                unfinished.release();
+                c->abandon();
+                throw;
+            }
+            done = true;
+            unfinished.release();
+            if (err) {
+                co_await c->wait_ready_for_query(c->s);
+                throw_error(err->fields);
+            }
+            auto results = co_await c->get_results(c->s);
+            if (!results.empty()) {
+                command_tag = results.back().command_tag;
+            }
+            co_return std::nullopt;
+        }
+        // binary format tuple, valid until the next call
+        task<std::optional<row_ref>> next_tuple() {
+            if (!format) {
+                throw std::runtime_error{"not a binary COPY"};
+            }
+            while (1) {
+                auto d = co_await next();
+                if (!d) {
+                    co_return std::nullopt;
+                }
+                auto p = *d;
+                if (!header_seen) {
+                    // signature, flags, header extension length and the extension
+                    constexpr auto signature = "PGCOPY\n\377\r\n\0"sv;
+                    be_i32 ext;
+                    if (p.size() < signature.size() + sizeof(i32) + sizeof(ext)
+                        || memcmp(p.data(), signature.data(), signature.size()) != 0) {
+                        throw std::runtime_error{"bad binary COPY header"};
+                    }
+                    memcpy(&ext, p.data() + signature.size() + sizeof(i32), sizeof(ext));
+                    p = p.subspan(signature.size() + sizeof(i32) + sizeof(ext));
+                    if (ext < 0 || p.size() < ext) {
+                        throw std::runtime_error{"bad binary COPY header"};
+                    }
+                    p = p.subspan(ext);
+                    header_seen = true;
+                }
+                // trailer: -1 instead of the column count
+                if (p.size() == sizeof(be_i16) && p[0] == 0xff && p[1] == 0xff) {
+                    continue;
+                }
+                row_ref t{p};
+                if (t.columns != columns) {
+                    throw std::runtime_error{"bad number of columns in binary COPY tuple"};
+                }
+                co_return t;
+            }
+        }
+        template <typename Row>
+        task<std::optional<Row>> next_row() {
+            static_assert(pg_owning_row<Row>, "the row outlives the copy_data it is decoded from, use std::string");
+            auto r = co_await next_tuple();
+            if (!r) {
+                co_return std::nullopt;
+            }
+            co_return pg_decode_row<Row>(r->data);
+        }
+    };
+
+    // runs one statement in the unnamed portal chunk_rows rows at a time, the next chunk is requested
+    // only when the previous one is consumed, so memory stays bounded and the first rows come early
+    // the transaction stays open (flush instead of sync) until the last chunk or close(),
+    // the connection must not be used for anything else meanwhile
+    struct portal_cursor {
+        pg_connection *c;
+        i32 chunk_rows;
+        // cache entry being prepared by the first chunk
+        statement_cache::entry *e;
+        // rows of the current chunk, the description is kept between chunks
+        pg_result r;
+        bool started{};
+        bool done{};
+        unfinished_guard unfinished{c};
+
+        // false when there are no more rows
+        task<bool> fetch() {
+            if (done) {
+                co_return false;
+            }
+            r.data.clear();
+            r.offsets.clear();
+            r.suspended = false;
+            if (started) {
+                c->append_message<execute>(""sv, chunk_rows);
+                c->append_message<struct flush>();
+                co_await c->flush_output(c->s);
+            }
+            started = true;
+            std::optional<pg_error> err;
+            std::exception_ptr ep;
+            try {
+                err = co_await c->get_result(c->s, r, std::exchange(e, nullptr), [](pg_result &r, const message_view &m) {
+                    r.add(m);
+                });
+            } catch (...) {
+                ep = std::current_exception();
+            }
+            if (ep || err) {
+                done = true;
+                unfinished.release();
+                c->statements.rollback();
+                if (ep) {
+                    c->abandon();
+                    std::rethrow_exception(ep);
+                }
+                // the server skips everything up to sync after an error
+                co_await c->send_message<struct sync>(c->s);
+                co_await c->wait_ready_for_query(c->s);
+                throw_error(err->fields);
+            }
+            if (!r.suspended) {
+                co_await close();
+            }
+            co_return !r.empty();
+        }
+        // ends the transaction, the portal is dropped with it
+        task<> close() {
+            if (done) {
+                co_return;
+            }
+            done = true;
+            unfinished.release();
+            co_await c->send_message<struct sync>(c->s);
+            co_await c->wait_ready_for_query(c->s);
+        }
+    };
+
+    std::map<std::string, std::string> params;
+    backend_key_data key_data;
+    static constexpr inline std::chrono::steady_clock::duration default_cancel_timeout = std::chrono::seconds{10};
+    // limit for the whole cancel request (connect, write, wait for the server to close)
+    std::chrono::steady_clock::duration cancel_timeout{default_cancel_timeout};
+    // key derivation (pbkdf2) runs there instead of inline when set, e.g. on a boost::asio::thread_pool
+    boost::asio::any_io_executor auth_executor;
+    receive_buffer input;
+    // outgoing messages are serialized here back to back and written out together at flush points,
+    // so a pipeline (parse, bind, execute, ..., sync) is one write and the buffer is reused between calls
+    std::string output;
+    statement_cache statements;
+    // counters of this connection, pg_metrics has them for the whole process
+    pg_connection_metrics metrics;
+    // when the latest query went out, latencies of its results are measured from there
+    pg_metrics::clock::time_point sent_at;
+    // tcp or unix domain socket
+    socket_type s;
+    // the server we are connected to
+    socket_type::endpoint_type endpoint;
+
+    pg_connection(boost::asio::io_context &ctx, auto &&connstr) : s{ctx} {
+        auto vec = split_string(connstr, " ");
+        for (auto &&v : vec) {
+            auto p = v.find('=');
+            if (p == -1) {
+                continue;
+            }
+            params[v.substr(0,p)] = v.substr(p+1);
+        }
+        // 0 disables the cache, every statement is then parsed into the unnamed one
+        if (auto i = params.find("statement_cache_size"); i != params.end()) {
+            statements.capacity = std::stoull(i->second);
+        }
+        // larger messages from the server abandon the connection
+        if (auto i = params.find("max_message_size"); i != params.end()) {
+            input.max_message_size = std::stoull(i->second);
+        }
+        // seconds
+        if (auto i = params.find("cancel_timeout"); i != params.end()) {
+            cancel_timeout = std::chrono::seconds{std::stoll(i->second)};
+        }
+    }
+    // host is a name or an address to connect over tcp, or like in libpq a directory (starts with /)
+    // with the server unix domain socket .s.PGSQL.<port> in it
+    task<> connect() {
+        auto start = pg_metrics::clock::now();
+        auto host = params.contains("host") ? params["host"] : "localhost"s;
+        auto port = params.contains("port") ? params["port"] : "5432"s;
+        if (host.starts_with('/')) {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            endpoint = boost::asio::local::stream_protocol::endpoint{host + "/.s.PGSQL." + port};
+            co_await s.async_connect(endpoint, boost::asio::use_awaitable);
+#else
+            throw std::runtime_error{"unix domain sockets are not supported"};
+#endif
+        } else {
+            ip::tcp::resolver resolver{s.get_executor()};
+            auto endpoints = co_await resolver.async_resolve(host, port, boost::asio::use_awaitable);
+            // every address of the host in turn
+            std::exception_ptr ep;
+            for (auto &&e : endpoints) {
+                try {
+                    endpoint = e.endpoint();
+                    co_await s.async_connect(endpoint, boost::asio::use_awaitable);
+                    ep = nullptr;
+                    break;
+                } catch (boost::system::system_error &) {
+                    ep = std::current_exception();
+                    s.close();
+                }
+            }
+            if (ep) {
+                std::rethrow_exception(ep);
+            }
+            // messages are already coalesced, do not hold back the last partial segment
+            s.set_option(ip::tcp::no_delay{true});
+        }
+
+        auto connected = pg_metrics::clock::now();
+        metrics.connect = connected - start;
+
+        i8 null{};
+        auto u = "user"sv;
+        co_await send_message<startup_message>(s, zero_byte{u}, zero_byte{params.at("user"s)}, null);
+        co_await auth(s);
+
+        while (1) {
+            auto m = co_await get_message(s);
+            if (message_type<backend_key_data> == m.h.type) {
+                auto k = pg_message_decoder<backend_key_data>::decode(m);
+                key_data.the_process_id_of_this_backend = k.the_process_id_of_this_backend;
+                key_data.the_secret_key_of_this_backend = k.the_secret_key_of_this_backend;
+            }
+            if (message_type<ready_for_query> == m.h.type) {
+                break;
+            }
+        }
+        metrics.auth = pg_metrics::clock::now() - connected;
+        auto &g = pg_metrics::local();
+        g.connected();
+        g.record(pg_phase::connect, metrics.connect);
+        g.record(pg_phase::auth, metrics.auth);
+    }
+    // asks the server to cancel whatever this connection is running, over a separate connection
+    // as the protocol wants; the running query then fails with 57014 query_canceled and
+    // the connection itself stays usable, a cancel that arrives when nothing runs is ignored by the server
+    // gives up with an error after cancel_timeout
+    task<> cancel() {
+        return cancel_request_to(s.get_executor(), endpoint, key_data, cancel_timeout);
+    }
+    // cancel() without the connection, for callers that may outlive it
+    static task<> cancel_request_to(boost::asio::any_io_executor ex, socket_type::endpoint_type endpoint,
+        backend_key_data key, std::chrono::steady_clock::duration timeout) {
+        // the timer closes the side socket, which fails whatever is pending on it
+        auto side = std::make_shared<socket_type>(ex);
+        auto timed_out = std::make_shared<bool>();
+        boost::asio::steady_timer timer{ex, timeout};
+        timer.async_wait([side, timed_out](const boost::system::error_code &ec) {
+            if (!ec) {
+                *timed_out = true;
+                boost::system::error_code ignored;
+                side->close(ignored);
+            }
+        });
+        std::exception_ptr ep;
+        try {
+            co_await side->async_connect(endpoint, boost::asio::use_awaitable);
+            std::string r;
+            pg_message_encoder<cancel_request>::encode(r, key.the_process_id_of_this_backend, key.the_secret_key_of_this_backend);
+            co_await boost::asio::async_write(*side, boost::asio::buffer(r), boost::asio::use_awaitable);
+            // there is no reply, the server closes the connection once the backend is signalled
+            i8 b;
+            boost::system::error_code ec;
+            co_await side->async_read_some(boost::asio::buffer(&b, sizeof(b)), boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        } catch (...) {
+            ep = std::current_exception();
+        }
+        timer.cancel();
+        if (*timed_out) {
+            throw std::runtime_error{"cancel request timed out"};
+        }
+        if (ep) {
+            std::rethrow_exception(ep);
+        }
+    }
+    // runs t (a query, pipeline, ... on this connection) and cancels it on the server
+    // when it is not done within timeout, so it fails with 57014 instead of holding the connection
+    // does not return before a started cancel is complete (or given up, see cancel()), so it cannot hit
+    // the next query; the watchdog keeps copies of what the cancel request needs and never touches
+    // the connection, it may outlive it when the caller is destroyed mid-flight
+    //   co_await c.with_timeout(5s, c.query("...", args...));
+    template <typename T>
+    task<T> with_timeout(std::chrono::steady_clock::duration timeout, task<T> t) {
+        struct state {
+            boost::asio::steady_timer timer;
+            boost::asio::steady_timer cancelled;
+            bool finished{};
+            bool cancelling{};
+        };
+        auto st = std::make_shared<state>(boost::asio::steady_timer{s.get_executor(), timeout},
+            boost::asio::steady_timer{s.get_executor()});
+        boost::asio::co_spawn(s.get_executor(), [st, ex = s.get_executor(), endpoint = endpoint, key = key_data,
+            cancel_timeout = cancel_timeout]() -> task<> {
+            boost::system::error_code ec;
+            co_await st->timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if (ec || st->finished) {
+                co_return;
+            }
+            st->cancelling = true;
+            try {
+                co_await cancel_request_to(ex, endpoint, key, cancel_timeout);
+            } catch (std::exception &) {
+                // the query just runs to completion
+            }
+            st->cancelling = false;
+            st->cancelled.cancel();
+        }, boost::asio::detached);
+        std::exception_ptr ep;
+        std::optional<std::conditional_t<std::is_void_v<T>, int, T>> r;
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await std::move(t);
+            } else {
+                r.emplace(co_await std::move(t));
+            }
+        } catch (...) {
+            ep = std::current_exception();
+        }
+        st->finished = true;
+        st->timer.cancel();
+        while (st->cancelling) {
+            st->cancelled.expires_at(boost::asio::steady_timer::time_point::max());
+            boost::system::error_code ec;
+            co_await st->cancelled.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+        }
+        if (ep) {
+            std::rethrow_exception(ep);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            co_return std::move(*r);
+        }
+    }
+    // simple query protocol, may contain several statements, one result per statement
+    task<std::vector<pg_result>> simple_query(std::string_view q) {
+        co_await send_query(q);
+        co_return co_await get_results(s);
+    }
+    // statements after a failed one are skipped by the server
+    task<pg_expected<std::vector<pg_result>>> try_simple_query(std::string_view q) {
+        co_await send_query(q);
+        co_return co_await try_get_results(s);
+    }
+    // COPY ... FROM STDIN through the simple query protocol
+    task<copy_writer> copy_in(std::string_view q, size_t frame_size = copy_writer::default_frame_size) {
+        co_await send_query(q);
+        auto r = co_await get_copy_response<copy_in_response>();
+        co_return copy_writer{this, r._0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc, frame_size};
+    }
+    // COPY ... TO STDOUT through the simple query protocol
+    task<copy_reader> copy_out(std::string_view q) {
+        co_await send_query(q);
+        auto r = co_await get_copy_response<copy_out_response>();
+        co_return copy_reader{this,
+            r._0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc,
+            (i16)r.elements.size()};
+    }
+    // the first reply to a COPY, decoded
+    // a server error is thrown once the connection is ready for queries again,
+    // anything else leaves the stream out of sync and abandons the connection
+    template <typename Type>
+    task<pg_message_decoder<Type>> get_copy_response() {
+        std::optional<pg_error> err;
+        try {
+            auto m = co_await next_query_message(s);
+            if (message_type<Type> == m.h.type) {
+                co_return pg_message_decoder<Type>::decode(m);
+            }
+            if (message_type<error_response> != m.h.type) {
+                throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+            }
+            err.emplace(m);
+            count_error(err->sqlstate());
+        } catch (...) {
+            abandon();
+            throw;
+        }
+        co_await wait_ready_for_query(s);
+        throw_error(err->fields);
+    }
+    // extended query protocol: one statement with text parameters, unnamed statement and portal
+    task<pg_result> query(std::string_view q, auto && ... args) {
+        pg_pipeline p;
+        p.query(q, args...);
+        auto results = co_await run(p);
+        co_return std::move(results.at(0));
+    }
+    // text parameters like query(), nothing is read until the first fetch()
+    task<portal_cursor> cursor(std::string_view q, i32 chunk_rows, auto && ... args) {
+        pg_pipeline p;
+        p.query(q, args...);
+        auto &st = p.statements.back();
+        portal_cursor cur{this, chunk_rows};
+        auto [e, prepare] = append_statement(st, chunk_rows);
+        if (prepare) {
+            cur.e = e;
+        } else {
+            cur.r.description = e->row_description;
+        }
+        append_message<struct flush>();
+        co_await flush_output(s);
+        co_return cur;
+    }
+    task<pg_expected<pg_result>> try_query(std::string_view q, auto && ... args) {
+        pg_pipeline p;
+        p.query(q, args...);
+        auto results = co_await try_run(p);
+        if (!results) {
+            co_return std::unexpected{std::move(results.error())};
+        }
+        co_return std::move(results->at(0));
+    }
+    // decodes every row into the Row aggregate, columns map to its fields by position
+    // results come in binary format, the decoder of every field is picked at compile time
+    // from its type (see pg_types.h), column types are checked once per result
+    template <typename Row>
+    task<std::vector<Row>> query(std::string_view q, auto && ... args) {
+        static_assert(pg_owning_row<Row>, "rows outlive the receive buffer they are decoded from, use std::string");
+        pg_pipeline p;
+        p.query(q, args...);
+        p.statements.back().result_format = 1;
+        std::vector<Row> rows;
+        co_await run(p, [&](pg_result &r, const message_view &m) {
+            if (rows.empty()) {
+                pg_check_columns<Row>(r.fields());
+            }
+            rows.emplace_back(pg_decode_row<Row>(m));
+        });
+        co_return rows;
+    }
+    // sends all queued statements followed by one Sync, results come back in order
+    // statements found in the cache skip Parse and Describe
+    // on error the server skips the rest of the pipeline, the error is rethrown once
+    // the connection is ready for queries again
+    task<std::vector<pg_result>> run(const pg_pipeline &p) {
+        co_return co_await run(p, [](pg_result &r, const message_view &m) {
+            r.add(m);
+        });
+    }
+    // on_row(pg_result &, const message_view &) gets every data row instead of storing it into the result
+    task<std::vector<pg_result>> run(const pg_pipeline &p, auto &&on_row) {
+        auto results = co_await try_run(p, on_row);
+        if (!results) {
+            throw_error(results.error().fields);
+        }
+        co_return std::move(*results);
+    }
+    // the first server error is returned once the connection is ready for queries again
+    task<pg_expected<std::vector<pg_result>>> try_run(const pg_pipeline &p) {
+        co_return co_await try_run(p, [](pg_result &r, const message_view &m) {
+            r.add(m);
+        });
+    }
+    task<pg_expected<std::vector<pg_result>>> try_run(const pg_pipeline &p, auto &&on_row) {
+        std::vector<prepared_statement> prepared;
+        prepared.reserve(p.statements.size());
+        for (auto &&st : p.statements) {
+            prepared.push_back(append_statement(st));
+        }
+        sent_at = pg_metrics::clock::now();
+        co_await send_message<struct sync>(s);
+        std::vector<pg_result> results(p.statements.size());
+        std::optional<pg_error> err;
+        std::exception_ptr ep;
+        try {
+            for (size_t i = 0; i < results.size() && !err; ++i) {
+                err = co_await get_statement_result(results[i], prepared[i], on_row);
+            }
+        } catch (...) {
+            ep = std::current_exception();
+        }
+        if (ep || err) {
+            statements.rollback();
+        }
+        // only a server error leaves the stream in a known state
+        if (ep) {
+            abandon();
+            std::rethrow_exception(ep);
+        }
+        co_await wait_ready_for_query(s);
+        if (err) {
+            co_return std::unexpected{std::move(*err)};
+        }
+        co_return results;
+    }
+    // every statement is its own implicit transaction (a Sync after each), still sent in one write
+    // a server error fails only its statement: the ones before it are committed, the ones after it run
+    // client side and i/o errors leave the stream out of sync, the socket is closed and they are rethrown
+    task<std::vector<pg_expected<pg_result>>> try_run_each(const pg_pipeline &p) {
+        std::vector<prepared_statement> prepared;
+        prepared.reserve(p.statements.size());
+        for (auto &&st : p.statements) {
+            prepared.push_back(append_statement(st));
+            append_message<struct sync>();
+        }
+        sent_at = pg_metrics::clock::now();
+        std::vector<pg_expected<pg_result>> results;
+        results.reserve(p.statements.size());
+        bool failed{};
+        std::exception_ptr ep;
+        try {
+            co_await flush_output(s);
+            for (auto &&st : prepared) {
+                pg_result r;
+                auto err = co_await get_statement_result(r, st, [](pg_result &r, const message_view &m) {
+                    r.add(m);
+                });
+                if (err) {
+                    failed = true;
+                    results.emplace_back(std::unexpected{std::move(*err)});
+                } else {
+                    results.emplace_back(std::move(r));
+                }
+                co_await wait_ready_for_query(s);
+            }
+        } catch (...) {
+            ep = std::current_exception();
+        }
+        if (ep) {
+            abandon();
+            std::rethrow_exception(ep);
+        }
+        if (failed) {
+            statements.rollback();
+        }
+        co_return results;
+    }
+    static std::string_view sasl_data(std::span<const i8> d) {
+        return {(const char *)d.data(), d.size()};
+    }
+    task<> auth(socket_type &s) {
+        auto m = co_await get_message<authentication_ok>(s);
+        // every 'R' message starts with the auth type, read it bounds-checked before anything else
+        switch (pg_decoder{m, message_type<authentication_ok>}.int32()) {
+        case authentication_ok::auth_type:
+            break;
+        case authentication_sasl::auth_type: {
+            // https://www.rfc-editor.org/rfc/rfc5802
+            auto type = "SCRAM-SHA-256"sv;
+            bool offered{};
+            for (auto &&e : pg_message_decoder<authentication_sasl>::decode(m).elements) {
+                offered |= e.name_of_a_sasl_authentication_mechanism == type;
+            }
+            if (!offered) {
+                throw std::runtime_error{"unknown sasl: "s};
+            }
+            std::string r;
+            r.resize(18, '0');
+            std::string str;
+            // no channel binding
+            auto channel = "n,,"s;
+            // pg ignores user and libpq sends empty username
+            // pg (and libpq) uses empty user (n=) because username is already sent
+            auto user_data = "n=,r=" + base64::encode(r);
+            str += channel + user_data;
+
+            co_await send_message<sasl_initial_response>(s, type, str);
+            auto sc = co_await get_auth_message<authentication_sasl_continue>(s);
+            auto sd = sasl_data(pg_message_decoder<authentication_sasl_continue>::decode(sc).sasl_data_specific_to_the_sasl_mechanism_being_used);
+            std::map<std::string, std::string> params;
+            auto vec = split_string(std::string{sd}, ",");
+            for (auto &&v : vec) {
+                auto p = v.find('=');
+                if (p == -1) {
+                    continue;
+                }
+                params[v.substr(0,p)] = v.substr(p+1);
+            }
+
+            using namespace crypto;
+            auto salt = base64::decode(params.at("s"));
+            auto keys = co_await scram_key_cache::instance().get(this->params["user"], this->params["password"],
+                std::string{salt.begin(), salt.end()}, std::stoi(std::string{params.at("i")}), auth_executor);
+            auto &client_key = keys.client_key;
+            auto &server_key = keys.server_key;
+            auto stored_key = sha256::digest(client_key);
+            auto new_client = "c=" + base64::encode(channel) + ",r=" + params.at("r");
+            auto auth_message = user_data + ","s + std::string{sd} + ","s + new_client;
+            auto client_signature = hmac<sha256>(stored_key, auth_message);
+            auto server_signature = hmac<sha256>(server_key, auth_message);
+            auto client_proof = client_key;
+            auto len = client_proof.size();
+            for (int i = 0; i < len; ++i) {
+                client_proof[i] ^= client_signature[i];
+            }
+            new_client += ",p=" + base64::encode(client_proof);
+
+            co_await send_message<sasl_response>(s, new_client);
+            auto scf = co_await get_auth_message<authentication_sasl_final>(s);
+            sd = sasl_data(pg_message_decoder<authentication_sasl_final>::decode(scf).sasl_outcome_additional_data__specific_to_the_sasl_mechanism_being_used);
+            vec = split_string(std::string{sd}, ",");
+            for (auto &&v : vec) {
+                auto p = v.find('=');
+                if (p == -1) {
+                    continue;
+                }
+                params[v.substr(0,p)] = v.substr(p+1);
+            }
+            len = server_signature.size();
+            auto verifier = base64::decode(params.at("v"));
+            if (verifier.size() != len || memcmp(server_signature.data(), verifier.data(), len) != 0) {
+                throw std::runtime_error{"bad server signature"};
+            }
+            co_await get_auth_message<authentication_ok>(s);
+            break;
+        }
+        default:
+            throw std::runtime_error{"unknown auth: "s};
+        }
+    }
+    // serializes the message into the output buffer, nothing is sent until flush_output()
+    template <typename Type>
+    void append_message(auto && ... args) {
+        auto pos = output.size();
+        if constexpr (requires {pg_message_encoder<Type>::fixed_size;}) {
+            pg_message_encoder<Type>::encode(output, args...);
+        } else {
+            // startup_message, its name/value pairs are given as zero_byte values and a final zero byte
+            Type message{};
+            output.append((const char *)&message, sizeof(message));
+            auto f = overload([&](const zero_byte &v) {
+                output.append((const char *)v.data(), v.size());
+                output += '\0';
+            },[&](const auto &v) {
+                output.append((const char *)&v, sizeof(v));
+            });
+            (f(args),...);
+            message.length = output.size() - pos;
+            memcpy(output.data() + pos, &message, sizeof(message));
+        }
+        // the startup message has no type byte, it is counted under 0
+        count_sent(message_type<Type>);
+    }
+    // the protocol state is unknown, nothing more can be sent or read on this connection
+    void abandon() {
+        output.clear();
+        boost::system::error_code ec;
+        s.close(ec);
+    }
+    task<> flush_output(socket_type &s) {
+        if (output.empty()) {
+            co_return;
+        }
+        try {
+            co_await boost::asio::async_write(s, boost::asio::buffer(output), boost::asio::use_awaitable);
+        } catch (...) {
+            // part of the buffer may have gone out, the stream is out of sync with the server:
+            // nothing is resent and the closed socket makes the pool drop the connection
+            output.clear();
+            boost::system::error_code ec;
+            s.close(ec);
+            throw;
+        }
+        metrics.bytes_out += output.size();
+        pg_metrics::local().sent(output.size());
+        output.clear();
+    }
+    // appends the message to whatever is already buffered and writes everything out
+    template <typename Type>
+    task<> send_message(socket_type &s, auto && ... args) {
+        append_message<Type>(args...);
+        co_await flush_output(s);
+    }
+    // simple query protocol message
+    task<> send_query(std::string_view q) {
+        count_query();
+        sent_at = pg_metrics::clock::now();
+        co_await send_message<struct query>(s, q);
+    }
+    // parse and describe the statement first unless it is already prepared
+    // max_rows 0 runs the portal to completion
+    void append_query(const pg_pipeline::statement &st, std::string_view name, bool prepare, i32 max_rows = 0) {
+        count_query();
+        if (prepare) {
+            // no parameter types (inferred by the server)
+            append_message<parse>(name, st.query, std::span<const i32>{});
+            append_message<describe>('S', name);
+        }
+        // unnamed portal, parameters in text format, one result format for all columns
+        append_message<struct bind>(""sv, name, std::span<const i16>{}, st.params, std::span<const i16>{&st.result_format, 1});
+        append_message<execute>(""sv, max_rows);
+    }
+    // cache entry of a statement (null when the cache is disabled) and whether it is being prepared
+    using prepared_statement = std::pair<statement_cache::entry *, bool>;
+    // appends the statement, prepared unless the cache has it already
+    // statements evicted from the cache meanwhile are closed in front of it
+    prepared_statement append_statement(const pg_pipeline::statement &st, i32 max_rows = 0) {
+        if (!statements.capacity) {
+            append_query(st, {}, true, max_rows);
+            return {nullptr, true};
+        }
+        auto [e, cached] = statements.get(st.query);
+        append_close_evicted();
+        append_query(st, e->name, !cached, max_rows);
+        return {e, !cached};
+    }
+    void append_close_evicted() {
+        while (!statements.evicted.empty()) {
+            auto &e = statements.evicted.front();
+            statements.closing.splice(statements.closing.end(), statements.evicted, statements.evicted.begin());
+            append_message<struct close>('S', e.name);
+        }
+    }
+    // reads messages of one extended query up to its completion or an error
+    // the statement description is stored into the cache entry when it was described
+    task<std::optional<pg_error>> get_result(socket_type &s, pg_result &r, statement_cache::entry *e, auto &&on_row) {
+        while (1) {
+            message_view m = co_await next_query_message(s);
+            std::optional<pg_error> err;
+            auto done = visit_backend(m, overload([&](const error_response *) {
+                err.emplace(m);
+                count_error(err->sqlstate());
+                return true;
+            }, [&](const parse_complete *) {
+                if (e) {
+                    e->prepared = true;
+                }
+                return false;
+            }, [&](const parameter_description *) {
+                if (e) {
+                    e->parameter_description.assign(m.data.begin(), m.data.end());
+                }
+                return false;
+            }, [&](const row_description *) {
+                r.add(m);
+                if (e) {
+                    e->row_description = r.description;
+                }
+                return false;
+            }, [&](const data_row *) {
+                on_row(r, m);
+                return false;
+            }, [&](const close_complete *) {
+                statements.closing.pop_front();
+                return false;
+            }, [](const bind_complete *) {
+                return false;
+            }, [](const no_data *) {
+                return false;
+            }, [&](const ready_for_query *) -> bool {
+                throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+            }, [&](const auto &) {
+                return r.add(m);
+            }));
+            if (done) {
+                co_return err;
+            }
+        }
+    }
+    // result of a statement appended with append_statement(), the latencies of its first row
+    // and of its completion are recorded
+    task<std::optional<pg_error>> get_statement_result(pg_result &r, prepared_statement st, auto &&on_row) {
+        auto [e, prepare] = st;
+        if (e && !prepare) {
+            r.description = e->row_description;
+        }
+        bool first{true};
+        auto err = co_await get_result(s, r, prepare ? e : nullptr, [&](pg_result &r, const message_view &m) {
+            if (first) {
+                first = false;
+                record_latency(pg_phase::first_row);
+            }
+            on_row(r, m);
+        });
+        if (!err) {
+            record_latency(pg_phase::complete);
+        }
+        co_return err;
+    }
+    // results of a simple query up to ready_for_query
+    task<std::vector<pg_result>> get_results(socket_type &s) {
+        auto results = co_await try_get_results(s);
+        if (!results) {
+            throw_error(results.error().fields);
+        }
+        co_return std::move(*results);
+    }
+    task<pg_expected<std::vector<pg_result>>> try_get_results(socket_type &s) {
+        std::vector<pg_result> results;
+        std::optional<pg_error> err;
+        std::exception_ptr ep;
+        try {
+            pg_result r;
+            bool first{true};
+            while (1) {
+                auto m = co_await next_query_message(s);
+                if (message_type<ready_for_query> == m.h.type) {
+                    break;
+                }
+                if (message_type<error_response> == m.h.type) {
+                    if (!err) {
+                        err.emplace(m);
+                        count_error(err->sqlstate());
+                    }
+                    continue;
+                }
+                // COPY ... FROM STDIN not run through copy_in(): the server waits for data,
+                // failing the COPY makes it report an error and get ready for queries
+                if (message_type<copy_in_response> == m.h.type) {
+                    co_await send_message<copy_fail>(s, "COPY FROM STDIN is only supported through copy_in()"sv);
+                    continue;
+                }
+                if (first && message_type<data_row> == m.h.type) {
+                    first = false;
+                    record_latency(pg_phase::first_row);
+                }
+                if (r.add(m)) {
+                    record_latency(pg_phase::complete);
+                    results.emplace_back(std::move(r));
+                    r = {};
+                    first = true;
+                }
+            }
+        } catch (...) {
+            ep = std::current_exception();
+        }
+        if (ep) {
+            abandon();
+            std::rethrow_exception(ep);
+        }
+        if (err) {
+            co_return std::unexpected{std::move(*err)};
+        }
+        co_return results;
+    }
+    // errors on the way are skipped too
+    // the connection is abandoned when the stream breaks before ready_for_query
+    task<> wait_ready_for_query(socket_type &s) {
+        try {
+            while (1) {
+                message_view m = co_await input.get_message(s);
+                count_received(m);
+                if (message_type<ready_for_query> == m.h.type) {
+                    break;
+                }
+            }
+        } catch (...) {
+            abandon();
+            throw;
+        }
+    }
+    // skips messages the server may send at any time
+    task<message_view> get_query_message(socket_type &s) {
+        message_view m = co_await next_query_message(s);
+        if (message_type<error_response> == m.h.type) {
+            auto fields = pg_error_fields(m);
+            count_error(fields.code);
+            throw_error(fields);
+        }
+        co_return m;
+    }
+    // same, but error_response is returned as any other message
+    task<message_view> next_query_message(socket_type &s) {
+        while (1) {
+            message_view m = co_await input.get_message(s);
+            count_received(m);
+            if (message_type<notice_response> == m.h.type || message_type<parameter_status> == m.h.type || message_type<notification_response> == m.h.type) {
+                continue;
+            }
+            co_return m;
+        }
+    }
+    template <typename Type>
+    task<message_view> get_auth_message(socket_type &s) {
+        message_view m = co_await get_message<Type>(s);
+        // checks the auth type too
+        pg_message_decoder<Type>::decode(m);
+        co_return m;
+    }
+    template <typename Type>
+    task<message_view> get_message(socket_type &s) {
+        message_view m = co_await get_message(s);
+        if (message_type<Type> != m.h.type) {
+            throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+        }
+        co_return m;
+    }
+    task<message_view> get_message(socket_type &s) {
+        auto m = co_await input.get_message(s);
+        count_received(m);
+        if (message_type<error_response> == m.h.type) {
+            auto fields = pg_error_fields(m);
+            count_error(fields.code);
+            throw_error(fields);
+        }
+        co_return m;
+    }
+    void count_received(const message_view &m) {
+        auto bytes = m.data.size();
+        metrics.bytes_in += bytes;
+        ++metrics.messages_in;
+        pg_metrics::local().message_in(m.h.type, bytes);
+    }
+    // errors are counted where they are decoded anyway
+    void count_error(std::string_view sqlstate) {
+        ++metrics.errors;
+        pg_metrics::local().error(sqlstate);
+    }
+    void count_sent(i8 type) {
+        ++metrics.messages_out;
+        pg_metrics::local().message_out(type);
+    }
+    void count_query() {
+        ++metrics.queries;
+        pg_metrics::local().query();
+    }
+    void record_latency(pg_phase p) {
+        pg_metrics::local().record(p, pg_metrics::clock::now() - sent_at);
+    }
+    [[noreturn]] static void throw_error(const error_response::error1 &e) {
+        std::cerr << e.format() << "\n";
+        throw std::runtime_error{std::format("error: {}"sv, e.format())};
+    }
+};
@@ -0,0 +1,724 @@
+// generated by pg_message_formats_parser from the PostgreSQL 17 docs, do not edit
+
+#pragma once
+
+#include "pg_messages.h"
+
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+
+// reads what pg_decoder has already checked
+struct pg_reader {
+    const i8 *p;
+
+    i8 byte() {
+        return *p++;
+    }
+    i8 int8() {
+        return byte();
+    }
+    i16 int16() {
+        return read<i16>();
+    }
+    i32 int32() {
+        return read<i32>();
+    }
+    template <typename T>
+    T read() {
+        T v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return std::byteswap(v);
+    }
+    std::string_view string() {
+        std::string_view v{(const char *)p};
+        p += v.size() + 1;
+        return v;
+    }
+    std::span<const i8> bytes(size_t n) {
+        std::span<const i8> v{p, n};
+        p += n;
+        return v;
+    }
+    std::optional<std::span<const i8>> value() {
+        auto len = int32();
+        if (len < 0) {
+            return std::nullopt;
+        }
+        return bytes(len);
+    }
+};
+
+// repeated part of a message, validated by the decoder
+// elements are read again while iterating, without checks and without allocating
+template <typename T>
+struct pg_list {
+    const i8 *p{};
+    size_t n{};
+
+    struct iterator {
+        pg_reader r;
+        size_t left;
+        T v{};
+
+        iterator(const i8 *p, size_t left) : r{p}, left{left} {
+            if (left) {
+                v = T::read(r);
+            }
+        }
+        const T &operator*() const {return v;}
+        const T *operator->() const {return &v;}
+        iterator &operator++() {
+            if (--left) {
+                v = T::read(r);
+            }
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t) const {return !left;}
+    };
+
+    auto begin() const {return iterator{p, n};}
+    auto end() const {return std::default_sentinel;}
+    auto size() const {return n;}
+    auto empty() const {return !n;}
+};
+
+// checks every read against the end of the message
+struct pg_decoder {
+    const i8 *p;
+    const i8 *end;
+
+    pg_decoder(const message_view &m, i8 type) : p{m.data.data() + sizeof(header)}, end{m.data.data() + m.data.size()} {
+        if (m.h.type != type || m.data.size() < sizeof(header)) {
+            throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+        }
+    }
+
+    void need(size_t n) const {
+        if ((size_t)(end - p) < n) {
+            throw std::runtime_error{"truncated message"};
+        }
+    }
+    void check(bool ok) const {
+        if (!ok) {
+            throw std::runtime_error{"unexpected message value"};
+        }
+    }
+    void done() const {
+        if (p != end) {
+            throw std::runtime_error{"trailing bytes in message"};
+        }
+    }
+
+    i8 byte() {
+        need(1);
+        return *p++;
+    }
+    i8 int8() {
+        return byte();
+    }
+    i16 int16() {
+        return read<i16>();
+    }
+    i32 int32() {
+        return read<i32>();
+    }
+    template <typename T>
+    T read() {
+        need(sizeof(T));
+        T v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return std::byteswap(v);
+    }
+    std::string_view string() {
+        auto z = (const i8 *)memchr(p, 0, end - p);
+        if (!z) {
+            throw std::runtime_error{"unterminated string in message"};
+        }
+        std::string_view v{(const char *)p, (size_t)(z - p)};
+        p = z + 1;
+        return v;
+    }
+    std::span<const i8> bytes(size_t n) {
+        need(n);
+        std::span<const i8> v{p, n};
+        p += n;
+        return v;
+    }
+    std::span<const i8> rest() {
+        return bytes(end - p);
+    }
+    std::optional<std::span<const i8>> value() {
+        auto len = int32();
+        if (len < 0) {
+            return std::nullopt;
+        }
+        return bytes(len);
+    }
+    template <typename T>
+    pg_list<T> list(i32 n) {
+        check(n >= 0);
+        pg_list<T> l{p, (size_t)n};
+        for (i32 i = 0; i < n; ++i) {
+            T::read(*this);
+        }
+        return l;
+    }
+    // elements up to a zero byte
+    template <typename T>
+    pg_list<T> terminated_list() {
+        pg_list<T> l{p};
+        while (1) {
+            need(1);
+            if (!*p) {
+                break;
+            }
+            T::read(*this);
+            ++l.n;
+        }
+        ++p;
+        return l;
+    }
+};
+
+// backend messages specialize it, decode() throws on a malformed message
+template <typename T>
+struct pg_message_decoder {};
+
+template <>
+struct pg_message_decoder<struct authentication_ok> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 0);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_kerberos_v5> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 2);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_cleartext_password> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 3);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_md5_password> {
+    std::span<const i8> the_salt_to_use_when_encrypting_the_password;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 5);
+        d.the_salt_to_use_when_encrypting_the_password = r.bytes(4);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_gss> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 7);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_gss_continue> {
+    std::span<const i8> gssapi_or_sspi_authentication_data;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 8);
+        d.gssapi_or_sspi_authentication_data = r.rest();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_sspi> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 9);
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_sasl> {
+    struct element {
+        std::string_view name_of_a_sasl_authentication_mechanism;
+
+        static element read(auto &r) {
+            element e;
+            e.name_of_a_sasl_authentication_mechanism = r.string();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 10);
+        d.elements = r.terminated_list<element>();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_sasl_continue> {
+    std::span<const i8> sasl_data_specific_to_the_sasl_mechanism_being_used;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 11);
+        d.sasl_data_specific_to_the_sasl_mechanism_being_used = r.rest();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct authentication_sasl_final> {
+    std::span<const i8> sasl_outcome_additional_data__specific_to_the_sasl_mechanism_being_used;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'R'};
+        pg_message_decoder d;
+        r.check(r.int32() == 12);
+        d.sasl_outcome_additional_data__specific_to_the_sasl_mechanism_being_used = r.rest();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct backend_key_data> {
+    i32 the_process_id_of_this_backend;
+    i32 the_secret_key_of_this_backend;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'K'};
+        pg_message_decoder d;
+        d.the_process_id_of_this_backend = r.int32();
+        d.the_secret_key_of_this_backend = r.int32();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct bind_complete> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, '2'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct close_complete> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, '3'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct command_complete> {
+    std::string_view the_command_tag;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'C'};
+        pg_message_decoder d;
+        d.the_command_tag = r.string();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct copy_data> {
+    std::span<const i8> data_that_forms_part_of_a_c_o_p_y_data_stream;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'd'};
+        pg_message_decoder d;
+        d.data_that_forms_part_of_a_c_o_p_y_data_stream = r.rest();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct copy_done> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'c'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct copy_in_response> {
+    struct element {
+        i16 the_format_codes_to_be_used_for_each_column;
+
+        static element read(auto &r) {
+            element e;
+            e.the_format_codes_to_be_used_for_each_column = r.int16();
+            return e;
+        }
+    };
+
+    i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'G'};
+        pg_message_decoder d;
+        d._0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc = r.int8();
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct copy_out_response> {
+    struct element {
+        i16 the_format_codes_to_be_used_for_each_column;
+
+        static element read(auto &r) {
+            element e;
+            e.the_format_codes_to_be_used_for_each_column = r.int16();
+            return e;
+        }
+    };
+
+    i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'H'};
+        pg_message_decoder d;
+        d._0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc = r.int8();
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct copy_both_response> {
+    struct element {
+        i16 the_format_codes_to_be_used_for_each_column;
+
+        static element read(auto &r) {
+            element e;
+            e.the_format_codes_to_be_used_for_each_column = r.int16();
+            return e;
+        }
+    };
+
+    i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'W'};
+        pg_message_decoder d;
+        d._0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc = r.int8();
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct data_row> {
+    struct element {
+        std::optional<std::span<const i8>> the_value_of_the_column_in_the_format_indicated_by_the_associated_format_code;
+
+        static element read(auto &r) {
+            element e;
+            e.the_value_of_the_column_in_the_format_indicated_by_the_associated_format_code = r.value();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'D'};
+        pg_message_decoder d;
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct empty_query_response> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'I'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct error_response> {
+    struct element {
+        i8 a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows;
+        std::string_view the_field_value;
+
+        static element read(auto &r) {
+            element e;
+            e.a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows = r.byte();
+            e.the_field_value = r.string();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'E'};
+        pg_message_decoder d;
+        d.elements = r.terminated_list<element>();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct function_call_response> {
+    std::optional<std::span<const i8>> the_value_of_the_function_result_in_the_format_indicated_by_the_associated_format_code;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'V'};
+        pg_message_decoder d;
+        d.the_value_of_the_function_result_in_the_format_indicated_by_the_associated_format_code = r.value();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct negotiate_protocol_version> {
+    struct element {
+        std::string_view the_option_name;
+
+        static element read(auto &r) {
+            element e;
+            e.the_option_name = r.string();
+            return e;
+        }
+    };
+
+    i32 newest_minor_protocol_version_supported_by_the_server_for_the_major_protocol_version_requested_by_the_client;
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'v'};
+        pg_message_decoder d;
+        d.newest_minor_protocol_version_supported_by_the_server_for_the_major_protocol_version_requested_by_the_client = r.int32();
+        d.elements = r.list<element>(r.int32());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct no_data> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'n'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct notice_response> {
+    struct element {
+        i8 a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows;
+        std::string_view the_field_value;
+
+        static element read(auto &r) {
+            element e;
+            e.a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows = r.byte();
+            e.the_field_value = r.string();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'N'};
+        pg_message_decoder d;
+        d.elements = r.terminated_list<element>();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct notification_response> {
+    i32 the_process_id_of_the_notifying_backend_process;
+    std::string_view the_name_of_the_channel_that_the_notify_has_been_raised_on;
+    std::string_view the__payload__string_passed_from_the_notifying_process;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'A'};
+        pg_message_decoder d;
+        d.the_process_id_of_the_notifying_backend_process = r.int32();
+        d.the_name_of_the_channel_that_the_notify_has_been_raised_on = r.string();
+        d.the__payload__string_passed_from_the_notifying_process = r.string();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct parameter_description> {
+    struct element {
+        i32 specifies_the_object_id_of_the_parameter_data_type;
+
+        static element read(auto &r) {
+            element e;
+            e.specifies_the_object_id_of_the_parameter_data_type = r.int32();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 't'};
+        pg_message_decoder d;
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct parameter_status> {
+    std::string_view the_name_of_the_run_time_parameter_being_reported;
+    std::string_view the_current_value_of_the_parameter;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'S'};
+        pg_message_decoder d;
+        d.the_name_of_the_run_time_parameter_being_reported = r.string();
+        d.the_current_value_of_the_parameter = r.string();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct parse_complete> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, '1'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct portal_suspended> {
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 's'};
+        pg_message_decoder d;
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct ready_for_query> {
+    i8 current_backend_transaction_status_indicator;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'Z'};
+        pg_message_decoder d;
+        d.current_backend_transaction_status_indicator = r.byte();
+        r.done();
+        return d;
+    }
+};
+
+template <>
+struct pg_message_decoder<struct row_description> {
+    struct element {
+        std::string_view the_field_name;
+        i32 if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_object_id_of_the_table_otherwise_zero;
+        i16 if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_attribute_number_of_the_column_otherwise_zero;
+        i32 the_object_id_of_the_field_s_data_type;
+        i16 the_data_type_size_see_pg_type;
+        i32 the_type_modifier_see_pg_attribute;
+        i16 the_format_code_being_used_for_the_field;
+
+        static element read(auto &r) {
+            element e;
+            e.the_field_name = r.string();
+            e.if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_object_id_of_the_table_otherwise_zero = r.int32();
+            e.if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_attribute_number_of_the_column_otherwise_zero = r.int16();
+            e.the_object_id_of_the_field_s_data_type = r.int32();
+            e.the_data_type_size_see_pg_type = r.int16();
+            e.the_type_modifier_see_pg_attribute = r.int32();
+            e.the_format_code_being_used_for_the_field = r.int16();
+            return e;
+        }
+    };
+
+    pg_list<element> elements;
+
+    static pg_message_decoder decode(const message_view &m) {
+        pg_decoder r{m, 'T'};
+        pg_message_decoder d;
+        d.elements = r.list<element>(r.int16());
+        r.done();
+        return d;
+    }
+};
@@ -0,0 +1,178 @@
+// generated by pg_message_formats_parser from the PostgreSQL 17 docs, do not edit
+
+#pragma once
+
+#include "pg_messages.h"
+
+#include <array>
+#include <variant>
+
+// the type byte of a message without constructing one, 0 for the untyped startup packets
+template <typename T>
+constexpr inline i8 message_type = 0;
+template <> constexpr inline i8 message_type<struct authentication_ok> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_kerberos_v5> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_cleartext_password> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_md5_password> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_gss> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_gss_continue> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_sspi> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_sasl> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_sasl_continue> = 'R';
+template <> constexpr inline i8 message_type<struct authentication_sasl_final> = 'R';
+template <> constexpr inline i8 message_type<struct backend_key_data> = 'K';
+template <> constexpr inline i8 message_type<struct bind> = 'B';
+template <> constexpr inline i8 message_type<struct bind_complete> = '2';
+template <> constexpr inline i8 message_type<struct close> = 'C';
+template <> constexpr inline i8 message_type<struct close_complete> = '3';
+template <> constexpr inline i8 message_type<struct command_complete> = 'C';
+template <> constexpr inline i8 message_type<struct copy_data> = 'd';
+template <> constexpr inline i8 message_type<struct copy_done> = 'c';
+template <> constexpr inline i8 message_type<struct copy_fail> = 'f';
+template <> constexpr inline i8 message_type<struct copy_in_response> = 'G';
+template <> constexpr inline i8 message_type<struct copy_out_response> = 'H';
+template <> constexpr inline i8 message_type<struct copy_both_response> = 'W';
+template <> constexpr inline i8 message_type<struct data_row> = 'D';
+template <> constexpr inline i8 message_type<struct describe> = 'D';
+template <> constexpr inline i8 message_type<struct empty_query_response> = 'I';
+template <> constexpr inline i8 message_type<struct error_response> = 'E';
+template <> constexpr inline i8 message_type<struct execute> = 'E';
+template <> constexpr inline i8 message_type<struct flush> = 'H';
+template <> constexpr inline i8 message_type<struct function_call> = 'F';
+template <> constexpr inline i8 message_type<struct function_call_response> = 'V';
+template <> constexpr inline i8 message_type<struct gss_response> = 'p';
+template <> constexpr inline i8 message_type<struct negotiate_protocol_version> = 'v';
+template <> constexpr inline i8 message_type<struct no_data> = 'n';
+template <> constexpr inline i8 message_type<struct notice_response> = 'N';
+template <> constexpr inline i8 message_type<struct notification_response> = 'A';
+template <> constexpr inline i8 message_type<struct parameter_description> = 't';
+template <> constexpr inline i8 message_type<struct parameter_status> = 'S';
+template <> constexpr inline i8 message_type<struct parse> = 'P';
+template <> constexpr inline i8 message_type<struct parse_complete> = '1';
+template <> constexpr inline i8 message_type<struct password_message> = 'p';
+template <> constexpr inline i8 message_type<struct portal_suspended> = 's';
+template <> constexpr inline i8 message_type<struct query> = 'Q';
+template <> constexpr inline i8 message_type<struct ready_for_query> = 'Z';
+template <> constexpr inline i8 message_type<struct row_description> = 'T';
+template <> constexpr inline i8 message_type<struct sasl_initial_response> = 'p';
+template <> constexpr inline i8 message_type<struct sasl_response> = 'p';
+template <> constexpr inline i8 message_type<struct sync> = 'S';
+template <> constexpr inline i8 message_type<struct terminate> = 'X';
+
+// incoming messages go through one indirect call on the type byte and a std::visit,
+// messages sharing the byte with an earlier one come as that first message
+using backend_message = std::variant<
+    std::monostate,
+    const struct authentication_ok *,
+    const struct backend_key_data *,
+    const struct bind_complete *,
+    const struct close_complete *,
+    const struct command_complete *,
+    const struct copy_data *,
+    const struct copy_done *,
+    const struct copy_in_response *,
+    const struct copy_out_response *,
+    const struct copy_both_response *,
+    const struct data_row *,
+    const struct empty_query_response *,
+    const struct error_response *,
+    const struct function_call_response *,
+    const struct negotiate_protocol_version *,
+    const struct no_data *,
+    const struct notice_response *,
+    const struct notification_response *,
+    const struct parameter_description *,
+    const struct parameter_status *,
+    const struct parse_complete *,
+    const struct portal_suspended *,
+    const struct ready_for_query *,
+    const struct row_description *
+>;
+using frontend_message = std::variant<
+    std::monostate,
+    const struct bind *,
+    const struct close *,
+    const struct copy_data *,
+    const struct copy_done *,
+    const struct copy_fail *,
+    const struct describe *,
+    const struct execute *,
+    const struct flush *,
+    const struct function_call *,
+    const struct gss_response *,
+    const struct parse *,
+    const struct query *,
+    const struct sync *,
+    const struct terminate *
+>;
+
+template <typename Message, typename T>
+Message make_message(const message_view &m) {
+    if constexpr (std::is_same_v<T, std::monostate>) {
+        return T{};
+    } else {
+        return &m.get<T>();
+    }
+}
+
+constexpr inline auto backend_messages = [] {
+    std::array<backend_message (*)(const message_view &), 256> t;
+    t.fill(make_message<backend_message, std::monostate>);
+    t['R'] = make_message<backend_message, struct authentication_ok>;
+    t['K'] = make_message<backend_message, struct backend_key_data>;
+    t['2'] = make_message<backend_message, struct bind_complete>;
+    t['3'] = make_message<backend_message, struct close_complete>;
+    t['C'] = make_message<backend_message, struct command_complete>;
+    t['d'] = make_message<backend_message, struct copy_data>;
+    t['c'] = make_message<backend_message, struct copy_done>;
+    t['G'] = make_message<backend_message, struct copy_in_response>;
+    t['H'] = make_message<backend_message, struct copy_out_response>;
+    t['W'] = make_message<backend_message, struct copy_both_response>;
+    t['D'] = make_message<backend_message, struct data_row>;
+    t['I'] = make_message<backend_message, struct empty_query_response>;
+    t['E'] = make_message<backend_message, struct error_response>;
+    t['V'] = make_message<backend_message, struct function_call_response>;
+    t['v'] = make_message<backend_message, struct negotiate_protocol_version>;
+    t['n'] = make_message<backend_message, struct no_data>;
+    t['N'] = make_message<backend_message, struct notice_response>;
+    t['A'] = make_message<backend_message, struct notification_response>;
+    t['t'] = make_message<backend_message, struct parameter_description>;
+    t['S'] = make_message<backend_message, struct parameter_status>;
+    t['1'] = make_message<backend_message, struct parse_complete>;
+    t['s'] = make_message<backend_message, struct portal_suspended>;
+    t['Z'] = make_message<backend_message, struct ready_for_query>;
+    t['T'] = make_message<backend_message, struct row_description>;
+    return t;
+}();
+inline backend_message dispatch_backend(const message_view &m) {
+    return backend_messages[m.h.type](m);
+}
+decltype(auto) visit_backend(const message_view &m, auto &&f) {
+    return std::visit(std::forward<decltype(f)>(f), dispatch_backend(m));
+}
+
+constexpr inline auto frontend_messages = [] {
+    std::array<frontend_message (*)(const message_view &), 256> t;
+    t.fill(make_message<frontend_message, std::monostate>);
+    t['B'] = make_message<frontend_message, struct bind>;
+    t['C'] = make_message<frontend_message, struct close>;
+    t['d'] = make_message<frontend_message, struct copy_data>;
+    t['c'] = make_message<frontend_message, struct copy_done>;
+    t['f'] = make_message<frontend_message, struct copy_fail>;
+    t['D'] = make_message<frontend_message, struct describe>;
+    t['E'] = make_message<frontend_message, struct execute>;
+    t['H'] = make_message<frontend_message, struct flush>;
+    t['F'] = make_message<frontend_message, struct function_call>;
+    t['p'] = make_message<frontend_message, struct gss_response>;
+    t['P'] = make_message<frontend_message, struct parse>;
+    t['Q'] = make_message<frontend_message, struct query>;
+    t['S'] = make_message<frontend_message, struct sync>;
+    t['X'] = make_message<frontend_message, struct terminate>;
+    return t;
+}();
+inline frontend_message dispatch_frontend(const message_view &m) {
+    return frontend_messages[m.h.type](m);
+}
+decltype(auto) visit_frontend(const message_view &m, auto &&f) {
+    return std::visit(std::forward<decltype(f)>(f), dispatch_frontend(m));
+}
@@ -0,0 +1,345 @@
+// generated by pg_message_formats_parser from the PostgreSQL 17 docs, do not edit
+
+#pragma once
+
+#include "pg_messages.h"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// writes a message in place at the end of out, out grows once by the whole message
+struct pg_encoder {
+    char *p;
+
+    pg_encoder(std::string &out, size_t size) {
+        auto pos = out.size();
+        out.resize(pos + size);
+        p = out.data() + pos;
+    }
+
+    void byte(i8 v) {
+        *p++ = v;
+    }
+    template <typename T>
+    void be(T v) {
+        v = std::byteswap(v);
+        memcpy(p, &v, sizeof(v));
+        p += sizeof(v);
+    }
+    void bytes(std::string_view v) {
+        memcpy(p, v.data(), v.size());
+        p += v.size();
+    }
+    void string(std::string_view v) {
+        bytes(v);
+        byte(0);
+    }
+    // count, then the elements
+    template <typename T>
+    void array(std::span<const T> v) {
+        be((i16)v.size());
+        for (auto x : v) {
+            be(x);
+        }
+    }
+    // length (-1 for none) and the value
+    void value(std::optional<std::string_view> v) {
+        be(v ? (i32)v->size() : -1);
+        if (v) {
+            bytes(*v);
+        }
+    }
+    // count, then a length and a value for every one, std::nullopt is NULL
+    void values(std::span<const std::optional<std::string>> v) {
+        be((i16)v.size());
+        for (auto &&x : v) {
+            value(x);
+        }
+    }
+
+    static size_t size(std::optional<std::string_view> v) {
+        return v ? v->size() : 0;
+    }
+    static size_t size(std::span<const std::optional<std::string>> v) {
+        size_t n{};
+        for (auto &&x : v) {
+            n += sizeof(i32) + (x ? x->size() : 0);
+        }
+        return n;
+    }
+};
+
+// frontend messages with an encoder specialize it
+// fixed_size is the message without its variable length fields
+template <typename T>
+struct pg_message_encoder {};
+
+template <>
+struct pg_message_encoder<struct bind> {
+    static constexpr inline size_t fixed_size = 13;
+
+    static void encode(std::string &out, std::string_view the_name_of_the_destination_portal_an_empty_string_selects_the_unnamed_portal_, std::string_view the_name_of_the_source_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_, std::span<const i16> the_parameter_format_codes, std::span<const std::optional<std::string>> the_value_of_the_parameter_in_the_format_indicated_by_the_associated_format_code, std::span<const i16> the_result_column_format_codes) {
+        auto size = fixed_size + the_name_of_the_destination_portal_an_empty_string_selects_the_unnamed_portal_.size() + the_name_of_the_source_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_.size() + the_parameter_format_codes.size_bytes() + pg_encoder::size(the_value_of_the_parameter_in_the_format_indicated_by_the_associated_format_code) + the_result_column_format_codes.size_bytes();
+        pg_encoder e{out, size};
+        e.byte('B');
+        e.be((i32)(size - 1));
+        e.string(the_name_of_the_destination_portal_an_empty_string_selects_the_unnamed_portal_);
+        e.string(the_name_of_the_source_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_);
+        e.array(the_parameter_format_codes);
+        e.values(the_value_of_the_parameter_in_the_format_indicated_by_the_associated_format_code);
+        e.array(the_result_column_format_codes);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct cancel_request> {
+    static constexpr inline size_t fixed_size = 16;
+
+    static void encode(std::string &out, i32 the_process_id_of_the_target_backend, i32 the_secret_key_for_the_target_backend) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.be((i32)(size));
+        e.be((i32)80877102);
+        e.be((i32)the_process_id_of_the_target_backend);
+        e.be((i32)the_secret_key_for_the_target_backend);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct close> {
+    static constexpr inline size_t fixed_size = 7;
+
+    static void encode(std::string &out, i8 _s_to_close_a_prepared_statement_or__p_to_close_a_portal, std::string_view the_name_of_the_prepared_statement_or_portal_to_close_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_) {
+        auto size = fixed_size + the_name_of_the_prepared_statement_or_portal_to_close_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_.size();
+        pg_encoder e{out, size};
+        e.byte('C');
+        e.be((i32)(size - 1));
+        e.byte(_s_to_close_a_prepared_statement_or__p_to_close_a_portal);
+        e.string(the_name_of_the_prepared_statement_or_portal_to_close_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct copy_data> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out, std::string_view data_that_forms_part_of_a_c_o_p_y_data_stream) {
+        auto size = fixed_size + data_that_forms_part_of_a_c_o_p_y_data_stream.size();
+        pg_encoder e{out, size};
+        e.byte('d');
+        e.be((i32)(size - 1));
+        e.bytes(data_that_forms_part_of_a_c_o_p_y_data_stream);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct copy_done> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.byte('c');
+        e.be((i32)(size - 1));
+    }
+};
+
+template <>
+struct pg_message_encoder<struct copy_fail> {
+    static constexpr inline size_t fixed_size = 6;
+
+    static void encode(std::string &out, std::string_view an_error_message_to_report_as_the_cause_of_failure) {
+        auto size = fixed_size + an_error_message_to_report_as_the_cause_of_failure.size();
+        pg_encoder e{out, size};
+        e.byte('f');
+        e.be((i32)(size - 1));
+        e.string(an_error_message_to_report_as_the_cause_of_failure);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct describe> {
+    static constexpr inline size_t fixed_size = 7;
+
+    static void encode(std::string &out, i8 _s_to_describe_a_prepared_statement_or__p_to_describe_a_portal, std::string_view the_name_of_the_prepared_statement_or_portal_to_describe_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_) {
+        auto size = fixed_size + the_name_of_the_prepared_statement_or_portal_to_describe_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_.size();
+        pg_encoder e{out, size};
+        e.byte('D');
+        e.be((i32)(size - 1));
+        e.byte(_s_to_describe_a_prepared_statement_or__p_to_describe_a_portal);
+        e.string(the_name_of_the_prepared_statement_or_portal_to_describe_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct execute> {
+    static constexpr inline size_t fixed_size = 10;
+
+    static void encode(std::string &out, std::string_view the_name_of_the_portal_to_execute_an_empty_string_selects_the_unnamed_portal_, i32 maximum_number_of_rows_to_return_if_portal_contains_a_query_that_returns_rows_ignored_otherwise_) {
+        auto size = fixed_size + the_name_of_the_portal_to_execute_an_empty_string_selects_the_unnamed_portal_.size();
+        pg_encoder e{out, size};
+        e.byte('E');
+        e.be((i32)(size - 1));
+        e.string(the_name_of_the_portal_to_execute_an_empty_string_selects_the_unnamed_portal_);
+        e.be((i32)maximum_number_of_rows_to_return_if_portal_contains_a_query_that_returns_rows_ignored_otherwise_);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct flush> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.byte('H');
+        e.be((i32)(size - 1));
+    }
+};
+
+template <>
+struct pg_message_encoder<struct function_call> {
+    static constexpr inline size_t fixed_size = 15;
+
+    static void encode(std::string &out, i32 specifies_the_object_id_of_the_function_to_call, std::span<const i16> the_argument_format_codes, std::span<const std::optional<std::string>> the_value_of_the_argument_in_the_format_indicated_by_the_associated_format_code, i16 the_format_code_for_the_function_result) {
+        auto size = fixed_size + the_argument_format_codes.size_bytes() + pg_encoder::size(the_value_of_the_argument_in_the_format_indicated_by_the_associated_format_code);
+        pg_encoder e{out, size};
+        e.byte('F');
+        e.be((i32)(size - 1));
+        e.be((i32)specifies_the_object_id_of_the_function_to_call);
+        e.array(the_argument_format_codes);
+        e.values(the_value_of_the_argument_in_the_format_indicated_by_the_associated_format_code);
+        e.be((i16)the_format_code_for_the_function_result);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct gssenc_request> {
+    static constexpr inline size_t fixed_size = 8;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.be((i32)(size));
+        e.be((i32)80877104);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct gss_response> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out, std::string_view gssapi_sspi_specific_message_data) {
+        auto size = fixed_size + gssapi_sspi_specific_message_data.size();
+        pg_encoder e{out, size};
+        e.byte('p');
+        e.be((i32)(size - 1));
+        e.bytes(gssapi_sspi_specific_message_data);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct parse> {
+    static constexpr inline size_t fixed_size = 9;
+
+    static void encode(std::string &out, std::string_view the_name_of_the_destination_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_, std::string_view the_query_string_to_be_parsed, std::span<const i32> specifies_the_object_id_of_the_parameter_data_type) {
+        auto size = fixed_size + the_name_of_the_destination_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_.size() + the_query_string_to_be_parsed.size() + specifies_the_object_id_of_the_parameter_data_type.size_bytes();
+        pg_encoder e{out, size};
+        e.byte('P');
+        e.be((i32)(size - 1));
+        e.string(the_name_of_the_destination_prepared_statement_an_empty_string_selects_the_unnamed_prepared_statement_);
+        e.string(the_query_string_to_be_parsed);
+        e.array(specifies_the_object_id_of_the_parameter_data_type);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct password_message> {
+    static constexpr inline size_t fixed_size = 6;
+
+    static void encode(std::string &out, std::string_view the_password_encrypted_if_requested_) {
+        auto size = fixed_size + the_password_encrypted_if_requested_.size();
+        pg_encoder e{out, size};
+        e.byte('p');
+        e.be((i32)(size - 1));
+        e.string(the_password_encrypted_if_requested_);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct query> {
+    static constexpr inline size_t fixed_size = 6;
+
+    static void encode(std::string &out, std::string_view the_query_string_itself) {
+        auto size = fixed_size + the_query_string_itself.size();
+        pg_encoder e{out, size};
+        e.byte('Q');
+        e.be((i32)(size - 1));
+        e.string(the_query_string_itself);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct sasl_initial_response> {
+    static constexpr inline size_t fixed_size = 10;
+
+    static void encode(std::string &out, std::string_view name_of_the_sasl_authentication_mechanism_that_the_client_selected, std::optional<std::string_view> sasl_mechanism_specific_initial_response_) {
+        auto size = fixed_size + name_of_the_sasl_authentication_mechanism_that_the_client_selected.size() + pg_encoder::size(sasl_mechanism_specific_initial_response_);
+        pg_encoder e{out, size};
+        e.byte('p');
+        e.be((i32)(size - 1));
+        e.string(name_of_the_sasl_authentication_mechanism_that_the_client_selected);
+        e.value(sasl_mechanism_specific_initial_response_);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct sasl_response> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out, std::string_view sasl_mechanism_specific_message_data) {
+        auto size = fixed_size + sasl_mechanism_specific_message_data.size();
+        pg_encoder e{out, size};
+        e.byte('p');
+        e.be((i32)(size - 1));
+        e.bytes(sasl_mechanism_specific_message_data);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct ssl_request> {
+    static constexpr inline size_t fixed_size = 8;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.be((i32)(size));
+        e.be((i32)80877103);
+    }
+};
+
+template <>
+struct pg_message_encoder<struct sync> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.byte('S');
+        e.be((i32)(size - 1));
+    }
+};
+
+template <>
+struct pg_message_encoder<struct terminate> {
+    static constexpr inline size_t fixed_size = 5;
+
+    static void encode(std::string &out) {
+        auto size = fixed_size;
+        pg_encoder e{out, size};
+        e.byte('X');
+        e.be((i32)(size - 1));
+    }
+};
@@ -22,6 +22,8 @@ deps:
 
 #include <algorithm>
 #include <ranges>
+#include <map>
+#include <set>
 #include <format>
 #include <print>
 
@@ -89,7 +91,9 @@ struct field {
         }
         return type.substr(p + 1, type.find(')') - (p+1));
     }
-    auto emit() const {
+    // a member of the pg_messages.h layout, integers are kept in network byte order
+    // commented out when it is not at a fixed offset from the start of the message
+    auto emit(bool commented) const {
         auto type = prepare_string(this->type);
 
         auto get_val = [&]() {
@@ -101,30 +105,56 @@ struct field {
             return "{" + get_default_value() + "}";
         };
 
-        auto v = get_default_value();
-        std::string s;
+        auto v = get_val();
+        // the message struct has a static auth_type constant of the same value
+        auto name = c_name() == "auth_type"sv ? "auth_type_"s : c_name();
+        std::string s = commented ? "    //" : "    ";
         if (type.starts_with("Byte")) {
             try {
                 auto bytes = std::stoi(type.substr(4));
                 if (bytes == 1) {
-                    s += std::format("    i8 {}{};\n", c_name(), v);
+                    s += std::format("i8 {}{};\n", name, v);
                 } else {
-                    s += std::format("    i8 {}[{}];\n", c_name(), bytes);
+                    s += std::format("i8 {}[{}];\n", name, bytes);
                 }
             } catch (std::exception &e) {
-                s += std::format("    i8 *{};\n", c_name());
+                s += std::format("i8 *{};\n", name);
             }
         } else if (type.starts_with("Int")) {
             auto bits = std::stoi(type.substr(3));
-            s += std::format("    i{} {}{};\n", bits, c_name(), v);
+            s += std::format("{}i{} {}{};\n", commented || bits == 8 ? "" : "be_", bits, name, v);
         } else if (type.starts_with("String")) {
-            s += std::format("    std::string {}{};\n", c_name(), v);
+            s += std::format("std::string {}{};\n", name, v);
         } else {
             throw std::runtime_error{"unknown type"};
         }
         boost::replace_all(s, "__", "_");
         return s;
     }
+    // integers, Byte1 and ByteN of a known n
+    bool is_fixed() const {
+        return is_int() || type.starts_with("Byte"sv) && !is_bytes();
+    }
+    // the number of repeated fields (or groups of them) that follow
+    bool is_count() const {
+        return is_int() && get_default_value().empty() && (comment.contains("number of"sv) || comment.contains("Number of"sv));
+    }
+    bool is_int() const {
+        return type.starts_with("Int"sv);
+    }
+    auto int_bits() const {
+        return std::stoi(type.substr(3));
+    }
+    // Byten, the rest of the message or a length given by another field
+    bool is_bytes() const {
+        return type == "Byten"sv;
+    }
+    // name as emit() writes it
+    std::string arg_name() const {
+        auto s = c_name();
+        boost::replace_all(s, "__", "_");
+        return s;
+    }
     std::string c_name() const {
         auto comment = prepare_string(this->comment);
 
@@ -167,30 +197,272 @@ struct type {
     std::string name;
     std::vector<field> fields;
 
+    // the docs give the zero byte after the last element only in prose
+    static inline const std::set<std::string> zero_terminated{"authentication_sasl", "error_response", "notice_response"};
+    // hand-written additions to the layout: a comment before the struct and members after the fields
+    static inline const std::map<std::string, std::pair<std::string, std::string>> additions{
+        {"error_response", {"// https://www.postgresql.org/docs/current/protocol-error-fields.html\n", R"x(
+    struct error1 {
+        std::string_view severity_localized;
+        std::string_view severity;
+        std::string_view code;
+        std::string_view message;
+        std::string_view detail;
+        std::string_view hint;
+        std::string_view position;
+        std::string_view internal_position;
+        std::string_view internal_query;
+        std::string_view where;
+        std::string_view schema;
+        std::string_view table;
+        std::string_view column;
+        std::string_view data_type;
+        std::string_view constraint;
+        std::string_view file;
+        std::string_view line;
+        std::string_view routine;
+
+        std::string format() const {
+            return std::format("{}: {}: {}: {}\n{}:{}: {}()", severity, code, message, detail, file, line, routine);
+        }
+    };
+)x"}},
+    };
+
+    // struct over the start of the message as it is on the wire, fields up to the first one
+    // that is not at a fixed offset (a string, a byte run, anything after a count or in a zero terminated list)
+    // are members, the rest is listed in comments and read with pg_message_decoder
     auto emit() const {
         auto name = prepare_string(this->name);
+        auto added = additions.find(c_name());
 
         std::string s;
+        if (added != additions.end()) {
+            s += added->second.first;
+        }
         s += std::format("struct {} {{\n", c_name());
-        bool fe{};
         if (name.contains("(B)"sv)) {
-            s += std::format("    static constexpr inline bool backend_type = true;\n", c_name());
+            s += "    static constexpr inline bool backend_type = true;\n";
         } else if (name.contains("(F)"sv)) {
-            fe = true;
-            s += std::format("    static constexpr inline bool frontend_type = true;\n", c_name());
+            s += "    static constexpr inline bool frontend_type = true;\n";
         } else if (name.contains("(F & B)"sv)) {
-            fe = true;
-            s += std::format("    static constexpr inline bool backend_type  = true;\n", c_name());
-            s += std::format("    static constexpr inline bool frontend_type = true;\n", c_name());
+            s += "    static constexpr inline bool backend_type  = true;\n";
+            s += "    static constexpr inline bool frontend_type = true;\n";
+        }
+        for (auto &&f : fields) {
+            if (f.c_name() == "auth_type"sv) {
+                s += std::format("    static constexpr inline i32 auth_type = {};\n", f.get_default_value());
+            }
+        }
+        s += "\n";
+        bool fixed{true};
+        for (auto &&f : fields) {
+            auto n = f.c_name();
+            if (!f.is_fixed() || zero_terminated.contains(c_name()) && n != "type"sv && n != "length"sv && n != "auth_type"sv) {
+                fixed = false;
+            }
+            s += f.emit(!fixed);
+            if (f.is_count()) {
+                fixed = false;
+            }
         }
+        if (added != additions.end()) {
+            s += added->second.second;
+        }
+        s += "};\n";
+        return s;
+    }
+    bool is_backend() const {
+        return name.contains("(B)"sv) || name.contains("(F & B)"sv);
+    }
+    bool is_frontend() const {
+        return name.contains("(F)"sv) || name.contains("(F & B)"sv);
+    }
+    // 'X' or empty for the messages without it (startup, cancel and encryption requests)
+    std::string type_byte() const {
+        if (fields.empty() || fields[0].c_name() != "type"sv) {
+            return {};
+        }
+        return fields[0].get_default_value();
+    }
+    // typed encoder of a frontend message, fixed size fields are summed at compile time
+    // and the whole message is written in place once its size is known
+    // empty for startup_message, its name/value pairs repeat up to a zero byte the docs give only in prose
+    std::string emit_encoder() const {
+        size_t fixed{};
+        std::string params, size, writes;
+        for (size_t i = 0; i < fields.size(); ++i) {
+            auto &f = fields[i];
+            auto name = f.arg_name();
+            auto v = f.get_default_value();
+            auto next = [&](size_t n) {
+                return i + n < fields.size() ? &fields[i + n] : nullptr;
+            };
+            if (name == "type"sv) {
+                fixed += 1;
+                writes += std::format("        e.byte({});\n", v);
+            } else if (name == "length"sv) {
+                fixed += 4;
+                writes += std::format("        e.be((i32)(size{}));\n", type_byte().empty() ? "" : " - 1");
+            } else if (f.is_int() && f.comment.contains("number of"sv) && next(1) && next(1)->is_int() && next(2) && next(2)->is_bytes()) {
+                // count, then a length and a value for every one
+                auto vname = next(2)->arg_name();
+                fixed += 2;
+                params += std::format(", std::span<const std::optional<std::string>> {}", vname);
+                size += std::format(" + pg_encoder::size({})", vname);
+                writes += std::format("        e.values({});\n", vname);
+                i += 2;
+            } else if (f.is_int() && f.comment.contains("number of"sv) && next(1) && next(1)->is_int()) {
+                // count, then the elements
+                auto aname = next(1)->arg_name();
+                fixed += 2;
+                params += std::format(", std::span<const i{}> {}", next(1)->int_bits(), aname);
+                size += std::format(" + {}.size_bytes()", aname);
+                writes += std::format("        e.array({});\n", aname);
+                i += 1;
+            } else if (name == "length2"sv && next(1) && next(1)->is_bytes()) {
+                // -1 when there is no value
+                auto vname = next(1)->arg_name();
+                fixed += 4;
+                params += std::format(", std::optional<std::string_view> {}", vname);
+                size += std::format(" + pg_encoder::size({})", vname);
+                writes += std::format("        e.value({});\n", vname);
+                i += 1;
+            } else if (f.is_int()) {
+                fixed += f.int_bits() / 8;
+                if (!v.empty()) {
+                    writes += std::format("        e.be((i{}){});\n", f.int_bits(), v);
+                } else {
+                    params += std::format(", i{} {}", f.int_bits(), name);
+                    writes += std::format("        e.be((i{}){});\n", f.int_bits(), name);
+                }
+            } else if (f.type.starts_with("Byte1"sv)) {
+                fixed += 1;
+                params += std::format(", i8 {}", name);
+                writes += std::format("        e.byte({});\n", name);
+            } else if (f.is_bytes()) {
+                params += std::format(", std::string_view {}", name);
+                size += std::format(" + {}.size()", name);
+                writes += std::format("        e.bytes({});\n", name);
+            } else if (f.type.starts_with("String"sv)) {
+                if (type_byte().empty()) {
+                    return {};
+                }
+                fixed += 1;
+                params += std::format(", std::string_view {}", name);
+                size += std::format(" + {}.size()", name);
+                writes += std::format("        e.string({});\n", name);
+            } else {
+                throw std::runtime_error{"unknown type"};
+            }
+        }
+        std::string s;
+        s += "template <>\n";
+        s += std::format("struct pg_message_encoder<struct {}> {{\n", c_name());
+        s += std::format("    static constexpr inline size_t fixed_size = {};\n", fixed);
         s += "\n";
-        for (auto &&f : fields
-            //| std::views::drop(fe ? 0 : 0)
-            //| std::views::take(2)
-            ) {
-            s += f.emit();
+        s += std::format("    static void encode(std::string &out{}) {{\n", params);
+        s += std::format("        auto size = fixed_size{};\n", size);
+        s += "        pg_encoder e{out, size};\n";
+        s += writes;
+        s += "    }\n";
+        s += "};\n";
+        return s;
+    }
+    // bounds checked view of a backend message, the whole message is validated once in decode()
+    // and the members point into it; repeated fields come as elements, read again without checks
+    std::string emit_decoder() const {
+        std::string members, reads, element_members, element_reads, list;
+        // element members and reads are nested one level deeper
+        auto add = [&](auto &&f, auto &&next, auto &i, auto &members, auto &reads, const std::string &indent, const std::string &obj) {
+            auto name = f.arg_name();
+            if (f.is_int() && !next(1)->is_bytes()) {
+                members += indent + std::format("i{} {};\n", f.int_bits(), name);
+                reads += std::format("{}{} = r.int{}();\n", obj, name, f.int_bits());
+            } else if (f.is_int()) {
+                // length (-1 for NULL) and the value
+                auto vname = next(1)->arg_name();
+                members += indent + std::format("std::optional<std::span<const i8>> {};\n", vname);
+                reads += std::format("{}{} = r.value();\n", obj, vname);
+                i += 1;
+            } else if (f.type.starts_with("Byte1"sv)) {
+                members += indent + std::format("i8 {};\n", name);
+                reads += std::format("{}{} = r.byte();\n", obj, name);
+            } else if (f.is_bytes()) {
+                members += indent + std::format("std::span<const i8> {};\n", name);
+                reads += std::format("{}{} = r.rest();\n", obj, name);
+            } else if (f.type.starts_with("Byte"sv)) {
+                members += indent + std::format("std::span<const i8> {};\n", name);
+                reads += std::format("{}{} = r.bytes({});\n", obj, name, std::stoi(f.type.substr(4)));
+            } else if (f.type.starts_with("String"sv)) {
+                members += indent + std::format("std::string_view {};\n", name);
+                reads += std::format("{}{} = r.string();\n", obj, name);
+            } else {
+                throw std::runtime_error{"unknown type"};
+            }
+        };
+        static const field none{};
+        for (size_t i = 0; i < fields.size(); ++i) {
+            auto &f = fields[i];
+            auto name = f.arg_name();
+            auto v = f.get_default_value();
+            auto next = [&](size_t n) -> const field * {
+                return i + n < fields.size() ? &fields[i + n] : &none;
+            };
+            if (name == "type"sv || name == "length"sv) {
+            } else if (f.is_int() && !v.empty()) {
+                reads += std::format("        r.check(r.int{}() == {});\n", f.int_bits(), v);
+            } else if (f.is_int() && (f.comment.contains("number of"sv) || f.comment.contains("Number of"sv)) || zero_terminated.contains(c_name())) {
+                // the rest of the message repeats
+                if (zero_terminated.contains(c_name())) {
+                    list = "r.terminated_list<element>()";
+                } else {
+                    list = std::format("r.list<element>(r.int{}())", f.int_bits());
+                    ++i;
+                }
+                for (; i < fields.size(); ++i) {
+                    auto next = [&](size_t n) -> const field * {
+                        return i + n < fields.size() ? &fields[i + n] : &none;
+                    };
+                    add(fields[i], next, i, element_members, element_reads, "        ", "            e.");
+                }
+            } else {
+                add(f, next, i, members, reads, "    ", "        d.");
+            }
+        }
+        std::string s;
+        s += "template <>\n";
+        s += std::format("struct pg_message_decoder<struct {}> {{\n", c_name());
+        if (!list.empty()) {
+            s += "    struct element {\n";
+            s += element_members;
+            s += "\n";
+            s += "        static element read(auto &r) {\n";
+            s += "            element e;\n";
+            s += element_reads;
+            s += "            return e;\n";
+            s += "        }\n";
+            s += "    };\n";
+            s += "\n";
+        }
+        s += members;
+        if (!list.empty()) {
+            s += "    pg_list<element> elements;\n";
+        }
+        if (!members.empty() || !list.empty()) {
+            s += "\n";
         }
-        s += std::format("}};\n");
+        s += "    static pg_message_decoder decode(const message_view &m) {\n";
+        s += std::format("        pg_decoder r{{m, {}}};\n", type_byte());
+        s += "        pg_message_decoder d;\n";
+        s += reads;
+        if (!list.empty()) {
+            s += std::format("        d.elements = {};\n", list);
+        }
+        s += "        r.done();\n";
+        s += "        return d;\n";
+        s += "    }\n";
+        s += "};\n";
         return s;
     }
     std::string c_name() const {
@@ -219,10 +491,14 @@ using types = std::vector<type>;
 
 struct parser {
     std::string page;
+    // pinned, "current" moves on every release (18 made the BackendKeyData secret variable length)
+    // and pg_messages.h is written against this one
+    static constexpr auto docs_version = "17";
+
     parser() {
-        auto fn = "protocol-message-formats.html";
+        auto fn = std::format("protocol-message-formats-{}.html", docs_version);
         if (!fs::exists(fn)) {
-            auto f = download_file("https://www.postgresql.org/docs/current/protocol-message-formats.html");
+            auto f = download_file(std::format("https://www.postgresql.org/docs/{}/protocol-message-formats.html", docs_version));
             write_file(fn, tidy_html(f));
         }
         page = read_file(fn);
@@ -248,22 +524,500 @@ struct parser {
     }
 };
 
+// pg_messages.h up to the message layouts
+constexpr auto messages_prelude = R"(#pragma once
+
+using i8 = uint8_t;
+using i16 = short;
+using i32 = int;
+
+#pragma pack(push, 1)
+template <typename T>
+struct be {
+    T value;
+
+    be() = default;
+    template <typename U> be(const U &v) {
+        value = v;
+        swap();
+    }
+    operator auto() const {
+        return std::byteswap(value);
+    }
+    template <typename U> be &operator+=(const U &v) {
+        swap() += v;
+        swap();
+        return *this;
+    }
+    be &operator--() {
+        --swap();
+        swap();
+        return *this;
+    }
+    T &swap() {
+        return value = std::byteswap(value);
+    }
+};
+using be_i16 = be<i16>;
+using be_i32 = be<i32>;
+
+struct header {
+    i8 type;
+    be_i32 length;
+};
+#pragma pack(pop)
+
+// these hold pointers, keep them naturally aligned
+struct message {
+    header h;
+    std::vector<i8> data;
+
+    template <typename T>
+    T &get() {
+        return *(T*)(data.data());
+    }
+};
+
+// points straight into the connection receive buffer, no allocation per message
+// valid only until the next get_message() on the same buffer: reading more data
+// may move or reallocate it, use to_message() to keep a message longer
+struct message_view {
+    header h;
+    std::span<const i8> data;
+
+    template <typename T>
+    const T &get() const {
+        return *(const T*)(data.data());
+    }
+    message to_message() const {
+        return {h, {data.begin(), data.end()}};
+    }
+    // over a whole message kept elsewhere, type byte and length included
+    static message_view from(std::span<const i8> data) {
+        message_view m;
+        memcpy(&m.h, data.data(), sizeof(header));
+        m.data = data;
+        return m;
+    }
+};
+
+//
+
+#pragma pack(push, 1)
+
+)";
+
+// written as is on top of the encoders
+constexpr auto encoder_prelude = R"(// writes a message in place at the end of out, out grows once by the whole message
+struct pg_encoder {
+    char *p;
+
+    pg_encoder(std::string &out, size_t size) {
+        auto pos = out.size();
+        out.resize(pos + size);
+        p = out.data() + pos;
+    }
+
+    void byte(i8 v) {
+        *p++ = v;
+    }
+    template <typename T>
+    void be(T v) {
+        v = std::byteswap(v);
+        memcpy(p, &v, sizeof(v));
+        p += sizeof(v);
+    }
+    void bytes(std::string_view v) {
+        memcpy(p, v.data(), v.size());
+        p += v.size();
+    }
+    void string(std::string_view v) {
+        bytes(v);
+        byte(0);
+    }
+    // count, then the elements
+    template <typename T>
+    void array(std::span<const T> v) {
+        be((i16)v.size());
+        for (auto x : v) {
+            be(x);
+        }
+    }
+    // length (-1 for none) and the value
+    void value(std::optional<std::string_view> v) {
+        be(v ? (i32)v->size() : -1);
+        if (v) {
+            bytes(*v);
+        }
+    }
+    // count, then a length and a value for every one, std::nullopt is NULL
+    void values(std::span<const std::optional<std::string>> v) {
+        be((i16)v.size());
+        for (auto &&x : v) {
+            value(x);
+        }
+    }
+
+    static size_t size(std::optional<std::string_view> v) {
+        return v ? v->size() : 0;
+    }
+    static size_t size(std::span<const std::optional<std::string>> v) {
+        size_t n{};
+        for (auto &&x : v) {
+            n += sizeof(i32) + (x ? x->size() : 0);
+        }
+        return n;
+    }
+};
+
+// frontend messages with an encoder specialize it
+// fixed_size is the message without its variable length fields
+template <typename T>
+struct pg_message_encoder {};
+)";
+
+// written as is on top of the decoders
+constexpr auto decoder_prelude = R"(// reads what pg_decoder has already checked
+struct pg_reader {
+    const i8 *p;
+
+    i8 byte() {
+        return *p++;
+    }
+    i8 int8() {
+        return byte();
+    }
+    i16 int16() {
+        return read<i16>();
+    }
+    i32 int32() {
+        return read<i32>();
+    }
+    template <typename T>
+    T read() {
+        T v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return std::byteswap(v);
+    }
+    std::string_view string() {
+        std::string_view v{(const char *)p};
+        p += v.size() + 1;
+        return v;
+    }
+    std::span<const i8> bytes(size_t n) {
+        std::span<const i8> v{p, n};
+        p += n;
+        return v;
+    }
+    std::optional<std::span<const i8>> value() {
+        auto len = int32();
+        if (len < 0) {
+            return std::nullopt;
+        }
+        return bytes(len);
+    }
+};
+
+// repeated part of a message, validated by the decoder
+// elements are read again while iterating, without checks and without allocating
+template <typename T>
+struct pg_list {
+    const i8 *p{};
+    size_t n{};
+
+    struct iterator {
+        pg_reader r;
+        size_t left;
+        T v{};
+
+        iterator(const i8 *p, size_t left) : r{p}, left{left} {
+            if (left) {
+                v = T::read(r);
+            }
+        }
+        const T &operator*() const {return v;}
+        const T *operator->() const {return &v;}
+        iterator &operator++() {
+            if (--left) {
+                v = T::read(r);
+            }
+            return *this;
+        }
+        bool operator==(std::default_sentinel_t) const {return !left;}
+    };
+
+    auto begin() const {return iterator{p, n};}
+    auto end() const {return std::default_sentinel;}
+    auto size() const {return n;}
+    auto empty() const {return !n;}
+};
+
+// checks every read against the end of the message
+struct pg_decoder {
+    const i8 *p;
+    const i8 *end;
+
+    pg_decoder(const message_view &m, i8 type) : p{m.data.data() + sizeof(header)}, end{m.data.data() + m.data.size()} {
+        if (m.h.type != type || m.data.size() < sizeof(header)) {
+            throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+        }
+    }
+
+    void need(size_t n) const {
+        if ((size_t)(end - p) < n) {
+            throw std::runtime_error{"truncated message"};
+        }
+    }
+    void check(bool ok) const {
+        if (!ok) {
+            throw std::runtime_error{"unexpected message value"};
+        }
+    }
+    void done() const {
+        if (p != end) {
+            throw std::runtime_error{"trailing bytes in message"};
+        }
+    }
+
+    i8 byte() {
+        need(1);
+        return *p++;
+    }
+    i8 int8() {
+        return byte();
+    }
+    i16 int16() {
+        return read<i16>();
+    }
+    i32 int32() {
+        return read<i32>();
+    }
+    template <typename T>
+    T read() {
+        need(sizeof(T));
+        T v;
+        memcpy(&v, p, sizeof(v));
+        p += sizeof(v);
+        return std::byteswap(v);
+    }
+    std::string_view string() {
+        auto z = (const i8 *)memchr(p, 0, end - p);
+        if (!z) {
+            throw std::runtime_error{"unterminated string in message"};
+        }
+        std::string_view v{(const char *)p, (size_t)(z - p)};
+        p = z + 1;
+        return v;
+    }
+    std::span<const i8> bytes(size_t n) {
+        need(n);
+        std::span<const i8> v{p, n};
+        p += n;
+        return v;
+    }
+    std::span<const i8> rest() {
+        return bytes(end - p);
+    }
+    std::optional<std::span<const i8>> value() {
+        auto len = int32();
+        if (len < 0) {
+            return std::nullopt;
+        }
+        return bytes(len);
+    }
+    template <typename T>
+    pg_list<T> list(i32 n) {
+        check(n >= 0);
+        pg_list<T> l{p, (size_t)n};
+        for (i32 i = 0; i < n; ++i) {
+            T::read(*this);
+        }
+        return l;
+    }
+    // elements up to a zero byte
+    template <typename T>
+    pg_list<T> terminated_list() {
+        pg_list<T> l{p};
+        while (1) {
+            need(1);
+            if (!*p) {
+                break;
+            }
+            T::read(*this);
+            ++l.n;
+        }
+        ++p;
+        return l;
+    }
+};
+
+// backend messages specialize it, decode() throws on a malformed message
+template <typename T>
+struct pg_message_decoder {};
+)";
+
+// type byte -> message tables, one per direction, and a variant over them
+// messages sharing the byte with an earlier one (authentication_*, the 'p' responses)
+// come as that first message and are told apart by their own fields
+struct dispatch {
+    std::string name;
+    std::string alternatives;
+    std::string table;
+    std::set<std::string> bytes;
+
+    void add(const type &t) {
+        auto b = t.type_byte();
+        if (b.empty() || !bytes.insert(b).second) {
+            return;
+        }
+        alternatives += std::format("    const struct {} *,\n", t.c_name());
+        table += std::format("    t[{}] = make_message<{}_message, struct {}>;\n", b, name, t.c_name());
+    }
+    std::string emit_variant() const {
+        std::string s;
+        s += std::format("using {}_message = std::variant<\n", name);
+        s += "    std::monostate,\n";
+        s += alternatives;
+        s.resize(s.size() - 2);
+        s += "\n>;\n";
+        return s;
+    }
+    std::string emit_table() const {
+        std::string s;
+        s += std::format("constexpr inline auto {}_messages = [] {{\n", name);
+        s += std::format("    std::array<{}_message (*)(const message_view &), 256> t;\n", name);
+        s += std::format("    t.fill(make_message<{}_message, std::monostate>);\n", name);
+        s += table;
+        s += "    return t;\n";
+        s += "}();\n";
+        s += std::format("inline {0}_message dispatch_{0}(const message_view &m) {{\n", name);
+        s += std::format("    return {}_messages[m.h.type](m);\n", name);
+        s += "}\n";
+        s += std::format("decltype(auto) visit_{}(const message_view &m, auto &&f) {{\n", name);
+        s += std::format("    return std::visit(std::forward<decltype(f)>(f), dispatch_{}(m));\n", name);
+        s += "}\n";
+        return s;
+    }
+};
+
 int main(int argc, char *argv[]) {
     parser p;
     auto ts = p.parse();
-    std::string raw, c, switch_;
+    std::string raw, c, encoders, decoders, message_types;
+    dispatch backend{"backend"}, frontend{"frontend"};
     for (auto &&t : ts) {
         raw += std::format("{}\n", t.name);
         for (auto &&f : t.fields) {
             raw += std::format("\t{}\n", f.type);
             raw += std::format("\t\t{}\n", f.comment);
         }
-        //switch_ += std::format("case {}: \n", t.emit());
         raw += "\n";
         c += std::format("{}\n", t.emit());
+        if (auto b = t.type_byte(); !b.empty()) {
+            message_types += std::format("template <> constexpr inline i8 message_type<struct {}> = {};\n", t.c_name(), b);
+        }
+        if (t.is_backend()) {
+            backend.add(t);
+            decoders += "\n" + t.emit_decoder();
+        }
+        if (t.is_frontend()) {
+            frontend.add(t);
+            if (auto e = t.emit_encoder(); !e.empty()) {
+                encoders += "\n" + e;
+            }
+        }
     }
+
+    std::string d;
+    d += std::format("// generated by pg_message_formats_parser from the PostgreSQL {} docs, do not edit\n", parser::docs_version);
+    d += "\n";
+    d += "#pragma once\n";
+    d += "\n";
+    d += "#include \"pg_messages.h\"\n";
+    d += "\n";
+    d += "#include <array>\n";
+    d += "#include <variant>\n";
+    d += "\n";
+    d += "// the type byte of a message without constructing one, 0 for the untyped startup packets\n";
+    d += "template <typename T>\n";
+    d += "constexpr inline i8 message_type = 0;\n";
+    d += message_types;
+    d += "\n";
+    d += "// incoming messages go through one indirect call on the type byte and a std::visit,\n";
+    d += "// messages sharing the byte with an earlier one come as that first message\n";
+    d += backend.emit_variant();
+    d += frontend.emit_variant();
+    d += "\n";
+    d += "template <typename Message, typename T>\n";
+    d += "Message make_message(const message_view &m) {\n";
+    d += "    if constexpr (std::is_same_v<T, std::monostate>) {\n";
+    d += "        return T{};\n";
+    d += "    } else {\n";
+    d += "        return &m.get<T>();\n";
+    d += "    }\n";
+    d += "}\n";
+    d += "\n";
+    d += backend.emit_table();
+    d += "\n";
+    d += frontend.emit_table();
+
+    std::string e;
+    e += std::format("// generated by pg_message_formats_parser from the PostgreSQL {} docs, do not edit\n", parser::docs_version);
+    e += "\n";
+    e += "#pragma once\n";
+    e += "\n";
+    e += "#include \"pg_messages.h\"\n";
+    e += "\n";
+    e += "#include <optional>\n";
+    e += "#include <span>\n";
+    e += "#include <string>\n";
+    e += "#include <string_view>\n";
+    e += "\n";
+    e += encoder_prelude;
+    e += encoders;
+
+    std::string dec;
+    dec += std::format("// generated by pg_message_formats_parser from the PostgreSQL {} docs, do not edit\n", parser::docs_version);
+    dec += "\n";
+    dec += "#pragma once\n";
+    dec += "\n";
+    dec += "#include \"pg_messages.h\"\n";
+    dec += "\n";
+    dec += "#include <iterator>\n";
+    dec += "#include <optional>\n";
+    dec += "#include <span>\n";
+    dec += "#include <string_view>\n";
+    dec += "\n";
+    dec += decoder_prelude;
+    dec += decoders;
+
+    std::string m;
+    m += std::format("// generated by pg_message_formats_parser from the PostgreSQL {} docs, do not edit\n", parser::docs_version);
+    m += "\n";
+    m += messages_prelude;
+    m += c;
+    m += "#pragma pack(pop)\n";
+
+    // everything is written into the current directory,
+    // with --check <dir> the headers there must be the same or it fails
     write_file("raw.txt", raw);
-    write_file("pg_protocol_messages.h", c);
-    write_file("pg_messages.h", c);
-    return 0;
+    std::vector<std::pair<std::string, std::string>> headers{
+        {"pg_messages.h", m},
+        {"pg_message_dispatch.h", d},
+        {"pg_message_encoders.h", e},
+        {"pg_message_decoders.h", dec},
+    };
+    int r = 0;
+    for (auto &&[fn, s] : headers) {
+        write_file(fn, s);
+        if (argc > 2 && argv[1] == "--check"sv) {
+            auto checked_in = fs::path{argv[2]} / fn;
+            if (!fs::exists(checked_in) || read_file(checked_in) != s) {
+                std::println(stderr, "{} differs from the generated {}", checked_in.string(), fn);
+                r = 1;
+            }
+        }
+    }
+    return r;
 }
@@ -1,3 +1,5 @@
+// generated by pg_message_formats_parser from the PostgreSQL 17 docs, do not edit
+
 #pragma once
 
 using i8 = uint8_t;
@@ -31,13 +33,16 @@ struct be {
         return value = std::byteswap(value);
     }
 };
+using be_i16 = be<i16>;
 using be_i32 = be<i32>;
 
 struct header {
     i8 type;
     be_i32 length;
 };
+#pragma pack(pop)
 
+// these hold pointers, keep them naturally aligned
 struct message {
     header h;
     std::vector<i8> data;
@@ -48,8 +53,33 @@ struct message {
     }
 };
 
+// points straight into the connection receive buffer, no allocation per message
+// valid only until the next get_message() on the same buffer: reading more data
+// may move or reallocate it, use to_message() to keep a message longer
+struct message_view {
+    header h;
+    std::span<const i8> data;
+
+    template <typename T>
+    const T &get() const {
+        return *(const T*)(data.data());
+    }
+    message to_message() const {
+        return {h, {data.begin(), data.end()}};
+    }
+    // over a whole message kept elsewhere, type byte and length included
+    static message_view from(std::span<const i8> data) {
+        message_view m;
+        memcpy(&m.h, data.data(), sizeof(header));
+        m.data = data;
+        return m;
+    }
+};
+
 //
 
+#pragma pack(push, 1)
+
 struct authentication_ok {
     static constexpr inline bool backend_type = true;
     static constexpr inline i32 auth_type = 0;
@@ -103,7 +133,7 @@ struct authentication_gss_continue {
     i8 type{'R'};
     be_i32 length;
     be_i32 auth_type_{8};
-    i8 *gssapi_or_sspi_authentication_data;
+    //i8 *gssapi_or_sspi_authentication_data;
 };
 
 struct authentication_sspi {
@@ -122,16 +152,7 @@ struct authentication_sasl {
     i8 type{'R'};
     be_i32 length;
     be_i32 auth_type_{10};
-
-    auto authentication_mechanism() const {
-        auto base = (const char *)&auth_type_ + sizeof(auth_type_);
-        std::vector<std::string_view> v;
-        while (*base) {
-            v.emplace_back(base);
-            base += v.back().size() + 1;
-        }
-        return v;
-    }
+    //std::string name_of_a_sasl_authentication_mechanism;
 };
 
 struct authentication_sasl_continue {
@@ -142,12 +163,6 @@ struct authentication_sasl_continue {
     be_i32 length;
     be_i32 auth_type_{11};
     //i8 *sasl_data_specific_to_the_sasl_mechanism_being_used;
-
-    auto server_data() const {
-        auto base = (const char *)&auth_type_ + sizeof(auth_type_);
-        std::string_view v{base, base + length - sizeof(length) - sizeof(auth_type_)};
-        return v;
-    }
 };
 
 struct authentication_sasl_final {
@@ -158,12 +173,6 @@ struct authentication_sasl_final {
     be_i32 length;
     be_i32 auth_type_{12};
     //i8 *sasl_outcome_additional_data__specific_to_the_sasl_mechanism_being_used;
-
-    auto server_data() const {
-        auto base = (const char *)&auth_type_ + sizeof(auth_type_);
-        std::string_view v{base, base + length - sizeof(length) - sizeof(auth_type_)};
-        return v;
-    }
 };
 
 struct backend_key_data {
@@ -202,9 +211,9 @@ struct cancel_request {
     static constexpr inline bool frontend_type = true;
 
     be_i32 length{16};
-    i32 the_cancel_request_code{80877102};
-    i32 the_process_id_of_the_target_backend;
-    i32 the_secret_key_for_the_target_backend;
+    be_i32 the_cancel_request_code{80877102};
+    be_i32 the_process_id_of_the_target_backend;
+    be_i32 the_secret_key_for_the_target_backend;
 };
 
 struct close {
@@ -212,7 +221,7 @@ struct close {
 
     i8 type{'C'};
     be_i32 length;
-    //i8 _s_to_close_a_prepared_statement_or__p_to_close_a_portal;
+    i8 _s_to_close_a_prepared_statement_or__p_to_close_a_portal;
     //std::string the_name_of_the_prepared_statement_or_portal_to_close_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_;
 };
 
@@ -228,7 +237,7 @@ struct command_complete {
 
     i8 type{'C'};
     be_i32 length;
-    std::string the_command_tag;
+    //std::string the_command_tag;
 };
 
 struct copy_data {
@@ -237,7 +246,7 @@ struct copy_data {
 
     i8 type{'d'};
     be_i32 length;
-    i8 *data_that_forms_part_of_a_c_o_p_y_data_stream;
+    //i8 *data_that_forms_part_of_a_c_o_p_y_data_stream;
 };
 
 struct copy_done {
@@ -253,7 +262,7 @@ struct copy_fail {
 
     i8 type{'f'};
     be_i32 length;
-    std::string an_error_message_to_report_as_the_cause_of_failure;
+    //std::string an_error_message_to_report_as_the_cause_of_failure;
 };
 
 struct copy_in_response {
@@ -262,8 +271,8 @@ struct copy_in_response {
     i8 type{'G'};
     be_i32 length;
     i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
-    i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
-    i16 the_format_codes_to_be_used_for_each_column;
+    be_i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
+    //i16 the_format_codes_to_be_used_for_each_column;
 };
 
 struct copy_out_response {
@@ -272,8 +281,8 @@ struct copy_out_response {
     i8 type{'H'};
     be_i32 length;
     i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
-    i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
-    i16 the_format_codes_to_be_used_for_each_column;
+    be_i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
+    //i16 the_format_codes_to_be_used_for_each_column;
 };
 
 struct copy_both_response {
@@ -282,8 +291,8 @@ struct copy_both_response {
     i8 type{'W'};
     be_i32 length;
     i8 _0_indicates_the_overall_c_o_p_y_format_is_textual_rows_separated_by_newlines_columns_separated_by_separator_characters_etc;
-    i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
-    i16 the_format_codes_to_be_used_for_each_column;
+    be_i16 the_number_of_columns_in_the_data_to_be_copied_denoted_n_below_;
+    //i16 the_format_codes_to_be_used_for_each_column;
 };
 
 struct data_row {
@@ -291,9 +300,9 @@ struct data_row {
 
     i8 type{'D'};
     be_i32 length;
-    i16 the_number_of_column_values_that_follow_possibly_zero_;
-    i32 the_length_of_the_column_value_in_bytes_this_count_does_not_include_itself_;
-    i8 *the_value_of_the_column_in_the_format_indicated_by_the_associated_format_code;
+    be_i16 the_number_of_column_values_that_follow_possibly_zero_;
+    //i32 the_length_of_the_column_value_in_bytes_this_count_does_not_include_itself_;
+    //i8 *the_value_of_the_column_in_the_format_indicated_by_the_associated_format_code;
 };
 
 struct describe {
@@ -301,7 +310,7 @@ struct describe {
 
     i8 type{'D'};
     be_i32 length;
-    //i8 _s_to_describe_a_prepared_statement_or__p_to_describe_a_portal;
+    i8 _s_to_describe_a_prepared_statement_or__p_to_describe_a_portal;
     //std::string the_name_of_the_prepared_statement_or_portal_to_describe_an_empty_string_selects_the_unnamed_prepared_statement_or_portal_;
 };
 
@@ -345,38 +354,6 @@ struct error_response {
             return std::format("{}: {}: {}: {}\n{}:{}: {}()", severity, code, message, detail, file, line, routine);
         }
     };
-
-    auto error() const {
-        auto base = (const char *)&length + sizeof(length);
-        error1 e;
-        while (*base) {
-            auto code = *base++;
-            std::string_view sv{base};
-            switch (code) {
-                case 'S': e.severity_localized = sv; break;
-                case 'V': e.severity = sv; break;
-                case 'C': e.code = sv; break;
-                case 'M': e.message = sv; break;
-                case 'D': e.detail = sv; break;
-                case 'H': e.hint = sv; break;
-                case 'P': e.position = sv; break;
-                case 'p': e.internal_position = sv; break;
-                case 'q': e.internal_query = sv; break;
-                case 'W': e.where = sv; break;
-                case 's': e.schema = sv; break;
-                case 't': e.table = sv; break;
-                case 'c': e.column = sv; break;
-                case 'd': e.data_type = sv; break;
-                case 'n': e.constraint = sv; break;
-                case 'F': e.file = sv; break;
-                case 'L': e.line = sv; break;
-                case 'R': e.routine = sv; break;
-                default: break;
-            }
-            base += sv.size() + 1;
-        }
-        return e;
-    }
 };
 
 struct execute {
@@ -400,13 +377,13 @@ struct function_call {
 
     i8 type{'F'};
     be_i32 length;
-    i32 specifies_the_object_id_of_the_function_to_call;
-    i16 the_number_of_argument_format_codes_that_follow_denoted_c_below_;
-    i16 the_argument_format_codes;
-    i16 specifies_the_number_of_arguments_being_supplied_to_the_function;
-    i32 the_length_of_the_argument_value_in_bytes_this_count_does_not_include_itself_;
-    i8 *the_value_of_the_argument_in_the_format_indicated_by_the_associated_format_code;
-    i16 the_format_code_for_the_function_result;
+    be_i32 specifies_the_object_id_of_the_function_to_call;
+    be_i16 the_number_of_argument_format_codes_that_follow_denoted_c_below_;
+    //i16 the_argument_format_codes;
+    //i16 specifies_the_number_of_arguments_being_supplied_to_the_function;
+    //i32 the_length_of_the_argument_value_in_bytes_this_count_does_not_include_itself_;
+    //i8 *the_value_of_the_argument_in_the_format_indicated_by_the_associated_format_code;
+    //i16 the_format_code_for_the_function_result;
 };
 
 struct function_call_response {
@@ -414,15 +391,15 @@ struct function_call_response {
 
     i8 type{'V'};
     be_i32 length;
-    i32 the_length_of_the_function_result_value_in_bytes_this_count_does_not_include_itself_;
-    i8 *the_value_of_the_function_result_in_the_format_indicated_by_the_associated_format_code;
+    be_i32 the_length_of_the_function_result_value_in_bytes_this_count_does_not_include_itself_;
+    //i8 *the_value_of_the_function_result_in_the_format_indicated_by_the_associated_format_code;
 };
 
 struct gssenc_request {
     static constexpr inline bool frontend_type = true;
 
     be_i32 length{8};
-    i32 the_gssapi_encryption_request_code{80877104};
+    be_i32 the_gssapi_encryption_request_code{80877104};
 };
 
 struct gss_response {
@@ -430,7 +407,7 @@ struct gss_response {
 
     i8 type{'p'};
     be_i32 length;
-    i8 *gssapi_sspi_specific_message_data;
+    //i8 *gssapi_sspi_specific_message_data;
 };
 
 struct negotiate_protocol_version {
@@ -438,9 +415,9 @@ struct negotiate_protocol_version {
 
     i8 type{'v'};
     be_i32 length;
-    i32 newest_minor_protocol_version_supported_by_the_server_for_the_major_protocol_version_requested_by_the_client;
-    i32 number_of_protocol_options_not_recognized_by_the_server;
-    std::string the_option_name;
+    be_i32 newest_minor_protocol_version_supported_by_the_server_for_the_major_protocol_version_requested_by_the_client;
+    be_i32 number_of_protocol_options_not_recognized_by_the_server;
+    //std::string the_option_name;
 };
 
 struct no_data {
@@ -455,8 +432,8 @@ struct notice_response {
 
     i8 type{'N'};
     be_i32 length;
-    i8 a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows;
-    std::string the_field_value;
+    //i8 a_code_identifying_the_field_type_if_zero_this_is_the_message_terminator_and_no_string_follows;
+    //std::string the_field_value;
 };
 
 struct notification_response {
@@ -464,9 +441,9 @@ struct notification_response {
 
     i8 type{'A'};
     be_i32 length;
-    i32 the_process_id_of_the_notifying_backend_process;
-    std::string the_name_of_the_channel_that_the_notify_has_been_raised_on;
-    std::string the__payload__string_passed_from_the_notifying_process;
+    be_i32 the_process_id_of_the_notifying_backend_process;
+    //std::string the_name_of_the_channel_that_the_notify_has_been_raised_on;
+    //std::string the__payload__string_passed_from_the_notifying_process;
 };
 
 struct parameter_description {
@@ -474,8 +451,8 @@ struct parameter_description {
 
     i8 type{'t'};
     be_i32 length;
-    i16 the_number_of_parameters_used_by_the_statement_can_be_zero_;
-    i32 specifies_the_object_id_of_the_parameter_data_type;
+    be_i16 the_number_of_parameters_used_by_the_statement_can_be_zero_;
+    //i32 specifies_the_object_id_of_the_parameter_data_type;
 };
 
 struct parameter_status {
@@ -483,8 +460,8 @@ struct parameter_status {
 
     i8 type{'S'};
     be_i32 length;
-    std::string the_name_of_the_run_time_parameter_being_reported;
-    std::string the_current_value_of_the_parameter;
+    //std::string the_name_of_the_run_time_parameter_being_reported;
+    //std::string the_current_value_of_the_parameter;
 };
 
 struct parse {
@@ -510,7 +487,7 @@ struct password_message {
 
     i8 type{'p'};
     be_i32 length;
-    std::string the_password_encrypted_if_requested_;
+    //std::string the_password_encrypted_if_requested_;
 };
 
 struct portal_suspended {
@@ -541,7 +518,7 @@ struct row_description {
 
     i8 type{'T'};
     be_i32 length;
-    //i16 specifies_the_number_of_fields_in_a_row_can_be_zero_;
+    be_i16 specifies_the_number_of_fields_in_a_row_can_be_zero_;
     //std::string the_field_name;
     //i32 if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_object_id_of_the_table_otherwise_zero;
     //i16 if_the_field_can_be_identified_as_a_column_of_a_specific_table_the_attribute_number_of_the_column_otherwise_zero;
@@ -557,7 +534,7 @@ struct sasl_initial_response {
     i8 type{'p'};
     be_i32 length;
     //std::string name_of_the_sasl_authentication_mechanism_that_the_client_selected;
-    //be_i32 length2;
+    //i32 length2;
     //i8 *sasl_mechanism_specific__initial_response_;
 };
 
@@ -573,14 +550,14 @@ struct ssl_request {
     static constexpr inline bool frontend_type = true;
 
     be_i32 length{8};
-    i32 the_ssl_request_code{80877103};
+    be_i32 the_ssl_request_code{80877103};
 };
 
 struct startup_message {
     static constexpr inline bool frontend_type = true;
 
     be_i32 length;
-    be_i32 the_protocol_version_number{0x030000};
+    be_i32 the_protocol_version_number{196608};
     //std::string the_parameter_name;
     //std::string the_parameter_value;
 };
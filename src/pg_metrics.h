@@ -0,0 +1,348 @@
+#pragma once
+
+#include "hdr_histogram.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// latency phases: connect (tcp), auth (startup up to ready for query), queue wait (pool acquire),
+// first row and complete (from sending a statement)
+enum class pg_phase {
+    connect,
+    auth,
+    queue_wait,
+    first_row,
+    complete,
+    count,
+};
+constexpr inline std::array<std::string_view, (size_t)pg_phase::count> pg_phase_names{
+    "connect", "auth", "queue_wait", "first_row", "complete",
+};
+
+// latency histogram with the layout of hdr_histogram in microseconds, counted with relaxed atomics:
+// only its thread writes it (a load and a store, no locked instruction), snapshots read it from any thread
+struct pg_latency_buckets {
+    // up to an hour, 2 significant digits
+    static inline const hdr_histogram layout{3'600'000'000, 2};
+
+    std::unique_ptr<std::atomic<int64_t>[]> counts{new std::atomic<int64_t>[layout.counts.size()]{}};
+
+    void record(int64_t us) {
+        auto &c = counts[layout.index_of(std::clamp<int64_t>(us, 0, layout.highest))];
+        c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    void add_to(hdr_histogram &h) const {
+        for (size_t i = 0; i < layout.counts.size(); ++i) {
+            if (auto n = counts[i].load(std::memory_order_relaxed)) {
+                auto v = layout.value_at_index(i);
+                h.counts[i] += n;
+                h.total += n;
+                h.min_value = std::min(h.min_value, v);
+                h.max_value = std::max(h.max_value, v);
+            }
+        }
+    }
+    // only for blocks of exited threads, under the registry lock
+    void add(const pg_latency_buckets &b) {
+        for (size_t i = 0; i < layout.counts.size(); ++i) {
+            counts[i].fetch_add(b.counts[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+    }
+};
+
+// error counts by SQLSTATE of one thread in a small open addressing table, the code is packed into the key
+// slots are only taken by the owning thread (or under the registry lock), so it needs no lock either;
+// codes that do not fit any more are counted as "other"
+struct pg_sqlstate_counts {
+    static constexpr inline size_t size = 64;
+
+    std::array<std::atomic<uint64_t>, size> keys{};
+    std::array<std::atomic<int64_t>, size> counts{};
+    std::atomic<int64_t> other{};
+
+    // up to 8 characters, SQLSTATE has 5
+    static uint64_t pack(std::string_view code) {
+        uint64_t k{};
+        for (auto ch : code.substr(0, sizeof(k))) {
+            k = k << 8 | (uint8_t)ch;
+        }
+        return k;
+    }
+    static std::string unpack(uint64_t k) {
+        std::string s;
+        for (; k; k >>= 8) {
+            s.insert(s.begin(), (char)(k & 0xff));
+        }
+        return s;
+    }
+    void add(uint64_t k, int64_t n) {
+        auto inc = [n](std::atomic<int64_t> &c) {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        };
+        if (!k) {
+            inc(other);
+            return;
+        }
+        for (size_t i = 0, h = k % size; i < size; ++i, h = (h + 1) % size) {
+            auto key = keys[h].load(std::memory_order_relaxed);
+            if (!key) {
+                // the count is published with the key
+                inc(counts[h]);
+                keys[h].store(k, std::memory_order_release);
+                return;
+            }
+            if (key == k) {
+                inc(counts[h]);
+                return;
+            }
+        }
+        inc(other);
+    }
+    void add(std::string_view code) {
+        add(pack(code), 1);
+    }
+    // only for blocks of exited threads, under the registry lock
+    void add(const pg_sqlstate_counts &c) {
+        for (size_t i = 0; i < size; ++i) {
+            if (auto k = c.keys[i].load(std::memory_order_acquire)) {
+                add(k, c.counts[i].load(std::memory_order_relaxed));
+            }
+        }
+        add(0, c.other.load(std::memory_order_relaxed));
+    }
+    void add_to(std::map<std::string, int64_t> &m) const {
+        for (size_t i = 0; i < size; ++i) {
+            if (auto k = keys[i].load(std::memory_order_acquire)) {
+                m[unpack(k)] += counts[i].load(std::memory_order_relaxed);
+            }
+        }
+        if (auto n = other.load(std::memory_order_relaxed)) {
+            m["other"] += n;
+        }
+    }
+};
+
+// counters of everything that went through the client since the start, added up over all threads
+struct pg_metrics_snapshot {
+    int64_t bytes_in{};
+    int64_t bytes_out{};
+    // by message type byte
+    std::array<int64_t, 256> messages_in{};
+    std::array<int64_t, 256> messages_out{};
+    int64_t queries{};
+    int64_t errors{};
+    std::map<std::string, int64_t> errors_by_sqlstate;
+    int64_t connects{};
+    int64_t reconnects{};
+    // microseconds
+    std::array<hdr_histogram, (size_t)pg_phase::count> latency;
+
+    pg_metrics_snapshot() {
+        latency.fill(pg_latency_buckets::layout);
+    }
+
+    // Prometheus text exposition format, latencies as histograms in seconds
+    // https://prometheus.io/docs/instrumenting/exposition_formats/
+    std::string prometheus(std::string_view prefix = "pg_client") const {
+        std::string s;
+        auto metric = [&](std::string_view name, std::string_view type, std::string_view help) {
+            s += std::format("# HELP {}_{} {}\n# TYPE {}_{} {}\n", prefix, name, help, prefix, name, type);
+        };
+        metric("bytes_total", "counter", "Protocol bytes received and sent.");
+        s += std::format("{}_bytes_total{{direction=\"in\"}} {}\n", prefix, bytes_in);
+        s += std::format("{}_bytes_total{{direction=\"out\"}} {}\n", prefix, bytes_out);
+        metric("messages_total", "counter", "Protocol messages received and sent by message type.");
+        for (auto [direction, messages] : {std::pair{"in", &messages_in}, std::pair{"out", &messages_out}}) {
+            for (int t = 0; t < 256; ++t) {
+                if ((*messages)[t]) {
+                    // untyped messages (startup) are under 0
+                    auto type = t > ' ' && t < 127 ? std::string(1, (char)t) : std::to_string(t);
+                    s += std::format("{}_messages_total{{direction=\"{}\",type=\"{}\"}} {}\n", prefix, direction, type, (*messages)[t]);
+                }
+            }
+        }
+        metric("queries_total", "counter", "Statements sent.");
+        s += std::format("{}_queries_total {}\n", prefix, queries);
+        metric("errors_total", "counter", "Error responses of the server by SQLSTATE.");
+        for (auto &&[code, n] : errors_by_sqlstate) {
+            s += std::format("{}_errors_total{{sqlstate=\"{}\"}} {}\n", prefix, code, n);
+        }
+        metric("connects_total", "counter", "Connections established.");
+        s += std::format("{}_connects_total {}\n", prefix, connects);
+        metric("reconnects_total", "counter", "Connections established to replace lost ones.");
+        s += std::format("{}_reconnects_total {}\n", prefix, reconnects);
+
+        constexpr double bounds[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+        metric("latency_seconds", "histogram", "Latency by phase.");
+        for (size_t p = 0; p < latency.size(); ++p) {
+            auto &h = latency[p];
+            auto phase = pg_phase_names[p];
+            int64_t n{};
+            double sum{};
+            size_t i{};
+            for (auto b : bounds) {
+                for (; i < h.counts.size() && h.highest_equivalent(h.value_at_index(i)) <= b * 1'000'000; ++i) {
+                    n += h.counts[i];
+                    sum += (double)h.median_equivalent(h.value_at_index(i)) * h.counts[i];
+                }
+                s += std::format("{}_latency_seconds_bucket{{phase=\"{}\",le=\"{}\"}} {}\n", prefix, phase, b, n);
+            }
+            for (; i < h.counts.size(); ++i) {
+                sum += (double)h.median_equivalent(h.value_at_index(i)) * h.counts[i];
+            }
+            s += std::format("{}_latency_seconds_bucket{{phase=\"{}\",le=\"+Inf\"}} {}\n", prefix, phase, h.count());
+            s += std::format("{}_latency_seconds_sum{{phase=\"{}\"}} {}\n", prefix, phase, sum / 1'000'000);
+            s += std::format("{}_latency_seconds_count{{phase=\"{}\"}} {}\n", prefix, phase, h.count());
+        }
+        return s;
+    }
+};
+
+// counters of one connection, pg_connection::metrics
+struct pg_connection_metrics {
+    int64_t bytes_in{};
+    int64_t bytes_out{};
+    int64_t messages_in{};
+    int64_t messages_out{};
+    int64_t queries{};
+    int64_t errors{};
+    std::chrono::steady_clock::duration connect{};
+    std::chrono::steady_clock::duration auth{};
+};
+
+// process-wide metrics kept in a block per thread, the hot path touches only the block of its own thread
+// without locking; snapshot() adds up all blocks and the counts of threads that have exited
+//   pg_metrics::local().record(pg_phase::complete, us);
+//   std::cout << pg_metrics::instance().snapshot().prometheus();
+struct pg_metrics {
+    using clock = std::chrono::steady_clock;
+
+    struct block {
+        std::atomic<int64_t> bytes_in{};
+        std::atomic<int64_t> bytes_out{};
+        std::array<std::atomic<int64_t>, 256> messages_in{};
+        std::array<std::atomic<int64_t>, 256> messages_out{};
+        std::atomic<int64_t> queries{};
+        std::atomic<int64_t> connects{};
+        std::atomic<int64_t> reconnects{};
+        std::array<pg_latency_buckets, (size_t)pg_phase::count> latency;
+        pg_sqlstate_counts errors;
+
+        // the owning thread is the only writer
+        static void add(std::atomic<int64_t> &c, int64_t n = 1) {
+            c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+        void message_in(uint8_t type, size_t bytes) {
+            add(messages_in[type]);
+            add(bytes_in, bytes);
+        }
+        void message_out(uint8_t type) {
+            add(messages_out[type]);
+        }
+        void sent(size_t bytes) {
+            add(bytes_out, bytes);
+        }
+        void query(int64_t n = 1) {
+            add(queries, n);
+        }
+        void connected() {
+            add(connects);
+        }
+        void reconnected() {
+            add(reconnects);
+        }
+        void error(std::string_view sqlstate) {
+            errors.add(sqlstate);
+        }
+        void record(pg_phase p, clock::duration d) {
+            latency[(size_t)p].record(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+        }
+        // adds b into this block, for blocks of exited threads
+        void add(block &b) {
+            auto add = [](std::atomic<int64_t> &to, const std::atomic<int64_t> &from) {
+                to.fetch_add(from.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            };
+            add(bytes_in, b.bytes_in);
+            add(bytes_out, b.bytes_out);
+            for (int t = 0; t < 256; ++t) {
+                add(messages_in[t], b.messages_in[t]);
+                add(messages_out[t], b.messages_out[t]);
+            }
+            add(queries, b.queries);
+            add(connects, b.connects);
+            add(reconnects, b.reconnects);
+            for (size_t p = 0; p < latency.size(); ++p) {
+                latency[p].add(b.latency[p]);
+            }
+            errors.add(b.errors);
+        }
+        void add_to(pg_metrics_snapshot &s) {
+            auto get = [](const std::atomic<int64_t> &c) {
+                return c.load(std::memory_order_relaxed);
+            };
+            s.bytes_in += get(bytes_in);
+            s.bytes_out += get(bytes_out);
+            for (int t = 0; t < 256; ++t) {
+                s.messages_in[t] += get(messages_in[t]);
+                s.messages_out[t] += get(messages_out[t]);
+            }
+            s.queries += get(queries);
+            s.connects += get(connects);
+            s.reconnects += get(reconnects);
+            for (size_t p = 0; p < latency.size(); ++p) {
+                latency[p].add_to(s.latency[p]);
+            }
+            errors.add_to(s.errors_by_sqlstate);
+        }
+    };
+    // registers the block of a thread on its first use and folds it into the retired one on thread exit
+    struct registration {
+        block b;
+
+        registration() {
+            auto &m = instance();
+            std::lock_guard lk{m.m};
+            m.blocks.push_back(&b);
+        }
+        ~registration() {
+            auto &m = instance();
+            std::lock_guard lk{m.m};
+            m.retired.add(b);
+            std::erase(m.blocks, &b);
+        }
+    };
+
+    std::mutex m;
+    std::vector<block *> blocks;
+    block retired;
+
+    static pg_metrics &instance() {
+        static pg_metrics m;
+        return m;
+    }
+    // block of the calling thread
+    static block &local() {
+        static thread_local registration r;
+        return r.b;
+    }
+
+    pg_metrics_snapshot snapshot() {
+        pg_metrics_snapshot s;
+        std::lock_guard lk{m};
+        retired.add_to(s);
+        for (auto b : blocks) {
+            b->add_to(s);
+        }
+        for (auto &&[code, n] : s.errors_by_sqlstate) {
+            s.errors += n;
+        }
+        return s;
+    }
+};
@@ -0,0 +1,731 @@
+#pragma once
+
+#include "pg_connection.h"
+
+#include <array>
+
+// scripted result of a statement, its rows are encoded once (in text and in binary format)
+// and sent from here as they are
+struct pg_mock_result {
+    std::vector<std::string> names;
+    std::vector<i32> oids;
+    // data_row messages back to back and where every row starts, by format code
+    std::string rows[2];
+    std::vector<size_t> offsets[2];
+    std::string command_tag;
+    // sqlstate and message, the statement fails with them
+    std::optional<std::pair<std::string, std::string>> error;
+
+    pg_mock_result() = default;
+    pg_mock_result(std::vector<std::string> names) : names{std::move(names)} {}
+
+    // a statement without rows, e.g. command("BEGIN")
+    static pg_mock_result command(std::string tag) {
+        pg_mock_result r;
+        r.command_tag = std::move(tag);
+        return r;
+    }
+    static pg_mock_result fail(std::string sqlstate, std::string message) {
+        pg_mock_result r;
+        r.error.emplace(std::move(sqlstate), std::move(message));
+        return r;
+    }
+
+    // one value per column, the types of the first row are the column types
+    pg_mock_result &row(const auto & ... values) {
+        if (sizeof...(values) != names.size()) {
+            throw std::runtime_error{"row does not match the columns"};
+        }
+        if (oids.empty()) {
+            (oids.push_back(oid_of<std::decay_t<decltype(values)>>()), ...);
+        }
+        auto add = [&](i16 format, auto &&f) {
+            auto &out = rows[format];
+            offsets[format].push_back(out.size());
+            auto pos = out.size();
+            data_row m{};
+            m.the_number_of_column_values_that_follow_possibly_zero_ = (i16)names.size();
+            out.append((const char *)&m, sizeof(m));
+            (f(out, values), ...);
+            be_i32 len = out.size() - pos - sizeof(m.type);
+            memcpy(out.data() + pos + sizeof(m.type), &len, sizeof(len));
+        };
+        add(0, [](std::string &out, const auto &v) {
+            auto p = pg_pipeline::to_parameter(v);
+            pg_append_be(out, p ? (i32)p->size() : -1);
+            if (p) {
+                out += *p;
+            }
+        });
+        add(1, [](std::string &out, const auto &v) {
+            pg_encode_field(out, v);
+        });
+        return *this;
+    }
+
+    auto size() const {return offsets[0].size();}
+    // rows [from, to) in the format
+    std::string_view rows_view(i16 format, size_t from, size_t to) const {
+        auto &o = offsets[format];
+        auto begin = from < o.size() ? o[from] : rows[format].size();
+        auto end = to < o.size() ? o[to] : rows[format].size();
+        return std::string_view{rows[format]}.substr(begin, end - begin);
+    }
+    std::string tag() const {
+        return command_tag.empty() ? std::format("SELECT {}", size()) : command_tag;
+    }
+
+    template <typename T>
+    static i32 oid_of() {
+        if constexpr (requires {pg_type<T>::oids;}) {
+            return pg_type<T>::oids[0];
+        } else {
+            // string literals, std::nullopt
+            return pg_type<std::string>::oids[0];
+        }
+    }
+};
+
+// backend speaking the v3 protocol over loopback tcp, for load tests without a database
+// the query text picks a scripted result, statements are not parsed and parameters are ignored
+// results must be scripted before start(), sessions read them without locking,
+// so the io_context of the server is run by a single thread
+//   pg_mock_server srv{ctx, "password"};
+//   srv.on("SELECT id, name FROM t", pg_mock_result{{"id", "name"}}.row(1, "a").row(2, "b"));
+//   srv.start();
+//   pg_connection c{ctx2, srv.connection_string("user")};
+struct pg_mock_server {
+    // replies are copied into the output buffer, larger row blocks are written from the result itself
+    static constexpr inline size_t copy_threshold = 16 * 1024;
+
+    ip::tcp::acceptor acceptor;
+    // SCRAM-SHA-256 with this password for every user, trust when not set
+    std::optional<std::string> password;
+    std::string salt{"pg_mock_server"};
+    int iterations;
+    scram_keys keys;
+    decltype(crypto::sha256::digest(scram_keys::key{})) stored_key;
+    std::map<std::string, pg_mock_result, std::less<>> results;
+    // backend key data of the next session
+    i32 next_pid{1};
+
+    pg_mock_server(boost::asio::io_context &ctx, std::optional<std::string> password = {}, int iterations = 4096)
+        : acceptor{ctx, ip::tcp::endpoint{ip::make_address_v4("127.0.0.1"), 0}}, password{std::move(password)}, iterations{iterations} {
+        if (this->password) {
+            keys = scram_keys::derive(*this->password, salt, iterations);
+            stored_key = crypto::sha256::digest(keys.client_key);
+        }
+    }
+
+    void on(std::string query, pg_mock_result r) {
+        results.insert_or_assign(std::move(query), std::move(r));
+    }
+    auto port() const {return acceptor.local_endpoint().port();}
+    std::string connection_string(std::string_view user) const {
+        return std::format("host=127.0.0.1 port={} user={} password={}", port(), user, password.value_or(""));
+    }
+    void start() {
+        boost::asio::co_spawn(acceptor.get_executor(), accept(), boost::asio::detached);
+    }
+    // open sessions end when their clients disconnect
+    void stop() {
+        acceptor.close();
+    }
+    task<> accept() {
+        while (1) {
+            auto s = co_await acceptor.async_accept(boost::asio::use_awaitable);
+            s.set_option(ip::tcp::no_delay{true});
+            boost::asio::co_spawn(acceptor.get_executor(), serve(std::move(s)), [](std::exception_ptr) {
+                // a client going away in the middle of a message is not an error of the server
+            });
+        }
+    }
+    task<> serve(ip::tcp::socket s) {
+        session ss{*this, std::move(s)};
+        co_await ss.run();
+    }
+
+    struct session {
+        pg_mock_server &srv;
+        ip::tcp::socket s;
+        receive_buffer input;
+        std::string output;
+        // prepared statements by name and their scripted result
+        std::map<std::string, const pg_mock_result *, std::less<>> statements;
+        // the unnamed portal, its result format and the rows it has already returned
+        const pg_mock_result *portal{};
+        i16 portal_format{};
+        size_t portal_row{};
+        // after an error in the extended query protocol messages are skipped up to sync
+        bool failed{};
+        // replies are written out once no complete message is left in the input
+        bool pending_flush{};
+
+        task<> run() {
+            std::string user;
+            if (!co_await startup(user) || !co_await auth(user)) {
+                co_return;
+            }
+            append_parameter_status("server_version", "17.0");
+            append_parameter_status("client_encoding", "UTF8");
+            append_parameter_status("DateStyle", "ISO, MDY");
+            append_parameter_status("integer_datetimes", "on");
+            backend_key_data k{};
+            k.the_process_id_of_this_backend = srv.next_pid++;
+            k.the_secret_key_of_this_backend = k.the_process_id_of_this_backend * 2654435761u;
+            append(k);
+            ready();
+            co_await flush();
+            while (1) {
+                if (pending_flush && input.size() < input.next_message_size()) {
+                    co_await flush();
+                }
+                auto m = co_await input.get_message(s);
+                // replies that may need a write of their own (rows, COPY) are handled after the dispatch
+                auto handled = visit_frontend(m, overload([&](const parse *) {
+                    on_parse(m);
+                    return true;
+                }, [&](const struct bind *) {
+                    on_bind(m);
+                    return true;
+                }, [&](const describe *) {
+                    on_describe(m);
+                    return true;
+                }, [&](const struct close *) {
+                    on_close(m);
+                    return true;
+                }, [&](const struct sync *) {
+                    failed = false;
+                    ready();
+                    pending_flush = true;
+                    return true;
+                }, [&](const struct flush *) {
+                    pending_flush = true;
+                    return true;
+                }, [](const copy_data *) {
+                    // left over from a failed COPY
+                    return true;
+                }, [](const copy_done *) {
+                    return true;
+                }, [](const copy_fail *) {
+                    return true;
+                }, [](const auto &) {
+                    return false;
+                }));
+                if (handled) {
+                    continue;
+                }
+                if (message_type<query> == m.h.type) {
+                    co_await simple_query(m);
+                } else if (message_type<execute> == m.h.type) {
+                    co_await on_execute(m);
+                } else if (message_type<terminate> == m.h.type) {
+                    co_return;
+                } else {
+                    append_error("08P01", "unsupported message: "s + (char)m.h.type);
+                    co_await flush();
+                    co_return;
+                }
+            }
+        }
+
+        // startup_message, an ssl or gss encryption request is declined first
+        // false for a cancel request, the mock runs every query to completion at once so there is nothing to cancel
+        task<bool> startup(std::string &user) {
+            while (1) {
+                be_i32 len;
+                co_await boost::asio::async_read(s, boost::asio::buffer(&len, sizeof(len)), boost::asio::use_awaitable);
+                if (len < 8 || len > 10'000) {
+                    throw std::runtime_error{"bad startup message length"};
+                }
+                std::vector<i8> body(len - sizeof(len));
+                co_await boost::asio::async_read(s, boost::asio::buffer(body), boost::asio::use_awaitable);
+                auto code = pg_reader{body.data()}.int32();
+                if (code == cancel_request{}.the_cancel_request_code) {
+                    co_return false;
+                }
+                if (code == ssl_request{}.the_ssl_request_code || code == gssenc_request{}.the_gssapi_encryption_request_code) {
+                    co_await boost::asio::async_write(s, boost::asio::buffer("N", 1), boost::asio::use_awaitable);
+                    continue;
+                }
+                if (code != startup_message{}.the_protocol_version_number) {
+                    throw std::runtime_error{"unsupported protocol version"};
+                }
+                // name/value pairs up to an empty name
+                std::string_view p{(const char *)body.data() + sizeof(code), body.size() - sizeof(code)};
+                while (!p.empty() && p[0]) {
+                    auto name = p.substr(0, p.find('\0'));
+                    p.remove_prefix(std::min(p.size(), name.size() + 1));
+                    auto value = p.substr(0, p.find('\0'));
+                    p.remove_prefix(std::min(p.size(), value.size() + 1));
+                    if (name == "user"sv) {
+                        user = value;
+                    }
+                }
+                co_return true;
+            }
+        }
+        // server side of https://www.rfc-editor.org/rfc/rfc5802
+        task<bool> auth(const std::string &user) {
+            using namespace crypto;
+            if (!srv.password) {
+                append_auth<authentication_ok>({});
+                co_return true;
+            }
+            append_auth<authentication_sasl>("SCRAM-SHA-256\0\0"sv);
+            co_await flush();
+
+            auto m = co_await input.get_message(s);
+            pg_decoder r{m, message_type<sasl_initial_response>};
+            auto mechanism = r.string();
+            auto first = view(r.bytes(r.int32()));
+            r.done();
+            // gs2 header without channel binding, then the bare message
+            auto gs2 = first.find(',', 2);
+            if (mechanism != "SCRAM-SHA-256"sv || !first.starts_with("n,") || gs2 == -1) {
+                co_return co_await auth_failed(user);
+            }
+            auto bare = first.substr(gs2 + 1);
+            auto nonce = std::format("{}{:08x}", attribute(bare, 'r'), srv.next_pid);
+            auto server_first = std::format("r={},s={},i={}", nonce, base64::encode(srv.salt), srv.iterations);
+            auto auth_message = std::string{bare} + "," + server_first + ",";
+            append_auth<authentication_sasl_continue>(server_first);
+            co_await flush();
+
+            m = co_await input.get_message(s);
+            pg_decoder r2{m, message_type<sasl_response>};
+            auto final = view(r2.rest());
+            auto p = final.rfind(",p=");
+            if (p == -1 || attribute(final, 'r') != nonce) {
+                co_return co_await auth_failed(user);
+            }
+            auth_message += final.substr(0, p);
+            // the proof is the client key masked by the signature, the stored key is its hash
+            auto proof = base64::decode(final.substr(p + 3));
+            auto client_signature = hmac<sha256>(srv.stored_key, auth_message);
+            auto client_key = srv.keys.client_key;
+            if (proof.size() != client_key.size()) {
+                co_return co_await auth_failed(user);
+            }
+            for (size_t i = 0; i < client_key.size(); ++i) {
+                client_key[i] = proof[i] ^ client_signature[i];
+            }
+            if (sha256::digest(client_key) != srv.stored_key) {
+                co_return co_await auth_failed(user);
+            }
+            auto server_signature = hmac<sha256>(srv.keys.server_key, auth_message);
+            append_auth<authentication_sasl_final>("v=" + base64::encode(server_signature));
+            append_auth<authentication_ok>({});
+            co_return true;
+        }
+        task<bool> auth_failed(const std::string &user) {
+            append_error("28P01", std::format("password authentication failed for user \"{}\"", user));
+            co_await flush();
+            co_return false;
+        }
+        static std::string_view view(std::span<const i8> d) {
+            return {(const char *)d.data(), d.size()};
+        }
+        static std::string_view attribute(std::string_view m, char name) {
+            for (size_t p = 0; p < m.size();) {
+                auto e = m.find(',', p);
+                auto a = m.substr(p, e == -1 ? std::string_view::npos : e - p);
+                if (a.size() > 1 && a[0] == name && a[1] == '=') {
+                    return a.substr(2);
+                }
+                if (e == -1) {
+                    break;
+                }
+                p = e + 1;
+            }
+            return {};
+        }
+
+        const pg_mock_result *find(std::string_view q) const {
+            auto i = srv.results.find(q);
+            return i == srv.results.end() ? nullptr : &i->second;
+        }
+        task<> simple_query(const message_view &m) {
+            pg_decoder r{m, message_type<query>};
+            auto q = r.string();
+            r.done();
+            if (q.find_first_not_of(" \t\r\n;") == -1) {
+                append(empty_query_response{});
+            } else if (is_copy(q, "FROM STDIN")) {
+                co_await copy_in(q);
+            } else if (is_copy(q, "TO STDOUT")) {
+                co_await copy_out(q);
+            } else if (auto res = find(q); !res) {
+                append_error("42601", std::format("no scripted result for: {}", q));
+            } else if (res->error) {
+                append_error(res->error->first, res->error->second);
+            } else {
+                if (!res->names.empty()) {
+                    append_description(*res, 0);
+                }
+                co_await append_rows(res->rows_view(0, 0, res->size()));
+                append_command_complete(res->tag());
+            }
+            ready();
+            pending_flush = true;
+        }
+
+        void on_parse(const message_view &m) {
+            if (failed) {
+                return;
+            }
+            pg_decoder r{m, message_type<parse>};
+            auto name = r.string();
+            auto q = r.string();
+            // parameter types
+            for (auto n = r.int16(); n > 0; --n) {
+                r.int32();
+            }
+            r.done();
+            auto res = find(q);
+            if (!res) {
+                return extended_error("42601", std::format("no scripted result for: {}", q));
+            }
+            if (auto i = statements.find(name); i != statements.end()) {
+                i->second = res;
+            } else {
+                statements.emplace(name, res);
+            }
+            append(parse_complete{});
+        }
+        void on_bind(const message_view &m) {
+            if (failed) {
+                return;
+            }
+            pg_decoder r{m, 'B'};
+            r.string();
+            auto name = r.string();
+            // parameter formats and values, then result formats
+            for (auto n = r.int16(); n > 0; --n) {
+                r.int16();
+            }
+            for (auto n = r.int16(); n > 0; --n) {
+                r.value();
+            }
+            i16 format{};
+            for (auto n = r.int16(); n > 0; --n) {
+                format |= r.int16();
+            }
+            r.done();
+            auto i = statements.find(name);
+            if (i == statements.end()) {
+                return extended_error("26000", std::format("prepared statement \"{}\" does not exist", name));
+            }
+            // one format for all columns
+            portal = i->second;
+            portal_format = format != 0;
+            portal_row = 0;
+            append(bind_complete{});
+        }
+        void on_describe(const message_view &m) {
+            if (failed) {
+                return;
+            }
+            pg_decoder r{m, message_type<describe>};
+            auto kind = r.byte();
+            auto name = r.string();
+            r.done();
+            const pg_mock_result *res = portal;
+            i16 format = portal_format;
+            if (kind == 'S') {
+                auto i = statements.find(name);
+                if (i == statements.end()) {
+                    return extended_error("26000", std::format("prepared statement \"{}\" does not exist", name));
+                }
+                res = i->second;
+                // formats are not known before bind
+                format = 0;
+                // no parameter types, they are not parsed out of the query
+                parameter_description p{};
+                append_message(p.type, [](std::string &out) {
+                    pg_append_be(out, (i16)0);
+                });
+            } else if (!portal) {
+                return extended_error("34000", "portal does not exist");
+            }
+            if (res->names.empty()) {
+                append(no_data{});
+            } else {
+                append_description(*res, format);
+            }
+        }
+        task<> on_execute(const message_view &m) {
+            if (failed) {
+                co_return;
+            }
+            pg_decoder r{m, message_type<execute>};
+            r.string();
+            auto max_rows = r.int32();
+            r.done();
+            if (!portal) {
+                co_return extended_error("34000", "portal does not exist");
+            }
+            if (portal->error) {
+                co_return extended_error(portal->error->first, portal->error->second);
+            }
+            auto n = portal->size() - portal_row;
+            if (max_rows > 0 && max_rows < n) {
+                n = max_rows;
+            }
+            co_await append_rows(portal->rows_view(portal_format, portal_row, portal_row + n));
+            portal_row += n;
+            if (portal_row < portal->size()) {
+                append(portal_suspended{});
+            } else {
+                append_command_complete(portal->tag());
+            }
+        }
+        void on_close(const message_view &m) {
+            if (failed) {
+                return;
+            }
+            pg_decoder r{m, 'C'};
+            auto kind = r.byte();
+            auto name = r.string();
+            r.done();
+            if (kind == 'S') {
+                if (auto i = statements.find(name); i != statements.end()) {
+                    statements.erase(i);
+                }
+            }
+            append(close_complete{});
+        }
+        void extended_error(std::string_view sqlstate, std::string_view message) {
+            append_error(sqlstate, message);
+            failed = true;
+        }
+
+        static bool is_copy(std::string_view q, std::string_view direction) {
+            auto upper = [](std::string_view v) {
+                std::string s{v};
+                for (auto &c : s) {
+                    c = toupper(c);
+                }
+                return s;
+            };
+            auto u = upper(q);
+            return u.starts_with("COPY ") && u.find(direction) != -1;
+        }
+        static bool is_binary_copy(std::string_view q) {
+            return q.find("binary") != -1 || q.find("BINARY") != -1;
+        }
+        // rows of text format are counted by their newlines, binary ones by their tuples at the end
+        task<> copy_in(std::string_view q) {
+            i8 format = is_binary_copy(q);
+            auto columns = [&] {
+                auto res = find(q);
+                return res ? (i16)res->names.size() : (i16)0;
+            }();
+            append_copy_response(message_type<copy_in_response>, format, columns);
+            co_await flush();
+            size_t rows{};
+            std::string binary;
+            bool done{};
+            while (!done) {
+                auto m = co_await input.get_message(s);
+                done = visit_frontend(m, overload([&](const copy_data *) {
+                    auto d = view(m.data.subspan(sizeof(header)));
+                    if (format) {
+                        binary += d;
+                    } else {
+                        rows += std::ranges::count(d, '\n');
+                    }
+                    return false;
+                }, [](const copy_done *) {
+                    return true;
+                }, [&](const copy_fail *) {
+                    pg_decoder r{m, message_type<copy_fail>};
+                    append_error("57014", std::format("COPY from stdin failed: {}", r.string()));
+                    return true;
+                }, [](const struct flush *) {
+                    return false;
+                }, [](const struct sync *) {
+                    return false;
+                }, [&](const auto &) {
+                    append_error("08P01", "unexpected message during COPY: "s + (char)m.h.type);
+                    return true;
+                }));
+                if (done && message_type<copy_done> != m.h.type) {
+                    co_return;
+                }
+            }
+            if (format) {
+                rows = count_tuples(binary);
+            }
+            append_command_complete(std::format("COPY {}", rows));
+        }
+        // header, then a field count and the fields of every tuple up to a -1 count
+        static size_t count_tuples(std::string_view d) {
+            constexpr auto header_size = 11 + 4 + 4;
+            size_t n{};
+            pg_reader r{(const i8 *)d.data() + std::min(d.size(), (size_t)header_size)};
+            auto end = (const i8 *)d.data() + d.size();
+            while (r.p + sizeof(i16) <= end) {
+                auto fields = r.int16();
+                if (fields < 0) {
+                    break;
+                }
+                for (i16 i = 0; i < fields && r.p + sizeof(i32) <= end; ++i) {
+                    auto len = r.int32();
+                    r.p += std::max(len, 0);
+                }
+                ++n;
+            }
+            return n;
+        }
+        // the scripted rows of the query as copy data, a binary tuple is the body of a binary data row
+        // like the server the binary header goes in front of the first tuple and the trailer on its own
+        task<> copy_out(std::string_view q) {
+            auto res = find(q);
+            if (!res) {
+                co_return append_error("42601", std::format("no scripted result for: {}", q));
+            }
+            i8 format = is_binary_copy(q);
+            append_copy_response(message_type<copy_out_response>, format, (i16)res->names.size());
+            bool header_sent{};
+            auto binary_header = [&](std::string &out) {
+                if (!std::exchange(header_sent, true)) {
+                    out += "PGCOPY\n\377\r\n\0"sv;
+                    pg_append_be(out, (i32)0);
+                    pg_append_be(out, (i32)0);
+                }
+            };
+            for (size_t i = 0; i < res->size(); ++i) {
+                auto row = res->rows_view(format, i, i + 1).substr(sizeof(header));
+                append_message(message_type<copy_data>, [&](std::string &out) {
+                    if (format) {
+                        binary_header(out);
+                        out += row;
+                        return;
+                    }
+                    // columns separated by tabs, \N is NULL
+                    pg_reader r{(const i8 *)row.data()};
+                    auto fields = r.int16();
+                    for (i16 f = 0; f < fields; ++f) {
+                        if (f) {
+                            out += '\t';
+                        }
+                        auto v = r.value();
+                        out += v ? view(*v) : "\\N"sv;
+                    }
+                    out += '\n';
+                });
+                if (output.size() >= copy_threshold) {
+                    co_await flush();
+                }
+            }
+            if (format) {
+                append_message(message_type<copy_data>, [&](std::string &out) {
+                    binary_header(out);
+                    pg_append_be(out, (i16)-1);
+                });
+            }
+            append(copy_done{});
+            append_command_complete(std::format("COPY {}", res->size()));
+        }
+
+        // fixed size messages are their struct
+        void append(const auto &m) {
+            output.append((const char *)&m, sizeof(m));
+        }
+        // f appends the body, the length is set afterwards
+        void append_message(i8 type, auto &&f) {
+            auto pos = output.size();
+            header h{type};
+            output.append((const char *)&h, sizeof(h));
+            f(output);
+            h.length = output.size() - pos - sizeof(h.type);
+            memcpy(output.data() + pos, &h, sizeof(h));
+        }
+        template <typename Type>
+        void append_auth(std::string_view data) {
+            append_message(message_type<Type>, [&](std::string &out) {
+                pg_append_be(out, Type::auth_type);
+                out += data;
+            });
+        }
+        void append_parameter_status(std::string_view name, std::string_view value) {
+            // parameter_status, not constructed as its struct holds strings
+            append_message('S', [&](std::string &out) {
+                out += name;
+                out += '\0';
+                out += value;
+                out += '\0';
+            });
+        }
+        void ready() {
+            ready_for_query r{};
+            r.current_backend_transaction_status_indicator = 'I';
+            append(r);
+        }
+        void append_error(std::string_view sqlstate, std::string_view message) {
+            append_message(message_type<error_response>, [&](std::string &out) {
+                auto add = [&](char code, std::string_view v) {
+                    out += code;
+                    out += v;
+                    out += '\0';
+                };
+                add('S', "ERROR");
+                add('V', "ERROR");
+                add('C', sqlstate);
+                add('M', message);
+                out += '\0';
+            });
+        }
+        void append_command_complete(std::string_view tag) {
+            append_message(message_type<command_complete>, [&](std::string &out) {
+                out += tag;
+                out += '\0';
+            });
+        }
+        void append_description(const pg_mock_result &res, i16 format) {
+            append_message(message_type<row_description>, [&](std::string &out) {
+                pg_append_be(out, (i16)res.names.size());
+                for (size_t i = 0; i < res.names.size(); ++i) {
+                    out += res.names[i];
+                    out += '\0';
+                    // no table, no column number
+                    pg_append_be(out, (i32)0);
+                    pg_append_be(out, (i16)0);
+                    pg_append_be(out, i < res.oids.size() ? res.oids[i] : pg_type<std::string>::oids[0]);
+                    // variable size, no type modifier
+                    pg_append_be(out, (i16)-1);
+                    pg_append_be(out, (i32)-1);
+                    pg_append_be(out, format);
+                }
+            });
+        }
+        void append_copy_response(i8 type, i8 format, i16 columns) {
+            append_message(type, [&](std::string &out) {
+                out += (char)format;
+                pg_append_be(out, columns);
+                for (i16 i = 0; i < columns; ++i) {
+                    pg_append_be(out, (i16)format);
+                }
+            });
+        }
+        // small blocks are copied behind the other replies, large ones go out in one write together with them
+        task<> append_rows(std::string_view rows) {
+            if (rows.size() < copy_threshold) {
+                output += rows;
+                co_return;
+            }
+            std::array<boost::asio::const_buffer, 2> b{boost::asio::buffer(output), boost::asio::buffer(rows)};
+            co_await boost::asio::async_write(s, b, boost::asio::use_awaitable);
+            output.clear();
+        }
+        task<> flush() {
+            pending_flush = false;
+            if (output.empty()) {
+                co_return;
+            }
+            co_await boost::asio::async_write(s, boost::asio::buffer(output), boost::asio::use_awaitable);
+            output.clear();
+        }
+    };
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "pg_connection.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+// keeps up to max_size authenticated connections and hands them out as leases
+// waiters are served in FIFO order, a released connection goes straight to the first one
+// connections idle for longer than idle_timeout are closed while there are more than min_size
+// the pool must outlive its leases
+struct pg_pool {
+    using clock = std::chrono::steady_clock;
+
+    struct options {
+        size_t min_size{1};
+        size_t max_size{16};
+        clock::duration idle_timeout{std::chrono::minutes{1}};
+        // passed to every connection, see pg_connection::auth_executor
+        boost::asio::any_io_executor auth_executor;
+    };
+
+    // returns the connection to the pool on destruction
+    // close the connection socket to drop it from the pool instead (e.g. after i/o errors)
+    struct lease {
+        pg_pool *pool{};
+        pg_connection *conn{};
+
+        lease() = default;
+        lease(pg_pool *pool, pg_connection *conn) : pool{pool}, conn{conn} {}
+        lease(lease &&rhs) noexcept : pool{rhs.pool}, conn{std::exchange(rhs.conn, nullptr)} {}
+        lease &operator=(lease &&rhs) noexcept {
+            if (this != &rhs) {
+                release();
+                pool = rhs.pool;
+                conn = std::exchange(rhs.conn, nullptr);
+            }
+            return *this;
+        }
+        ~lease() {
+            release();
+        }
+
+        pg_connection *operator->() const {return conn;}
+        pg_connection &operator*() const {return *conn;}
+        explicit operator bool() const {return conn;}
+
+        void release() {
+            if (conn) {
+                pool->release(std::exchange(conn, nullptr));
+            }
+        }
+    };
+    struct idle_connection {
+        pg_connection *conn;
+        clock::time_point since;
+    };
+    struct waiter {
+        boost::asio::steady_timer timer;
+        // null when woken because a slot was freed, not to hand over a connection
+        pg_connection *conn{};
+    };
+
+    boost::asio::io_context &ctx;
+    std::string connstr;
+    options opts;
+    std::vector<std::unique_ptr<pg_connection>> connections;
+    // most recently used at the back, so the hot set stays small and the rest can be reaped
+    std::deque<idle_connection> idle;
+    std::deque<waiter *> waiters;
+    size_t connecting{};
+    // dropped after an error and not replaced yet, the next connections opened count as reconnects
+    size_t lost{};
+    boost::asio::steady_timer reap_timer;
+
+    pg_pool(boost::asio::io_context &ctx, auto &&connstr, options opts = {})
+        : ctx{ctx}, connstr{connstr}, opts{opts}, reap_timer{ctx} {
+    }
+    ~pg_pool() {
+        stop();
+    }
+
+    auto size() const {return connections.size() + connecting;}
+
+    // opens min_size connections and starts reaping idle ones
+    task<> start() {
+        while (size() < opts.min_size) {
+            release(co_await open());
+        }
+        boost::asio::co_spawn(ctx, reap(), boost::asio::detached);
+    }
+    void stop() {
+        reap_timer.cancel();
+    }
+    // the time to get a connection is recorded as pg_phase::queue_wait
+    task<lease> acquire() {
+        auto start = clock::now();
+        bool retry{};
+        while (1) {
+            if (!idle.empty()) {
+                auto c = idle.back().conn;
+                idle.pop_back();
+                co_return leased(c, start);
+            }
+            if (size() < opts.max_size) {
+                co_return leased(co_await open(), start);
+            }
+            waiter w{boost::asio::steady_timer{ctx, clock::time_point::max()}};
+            // keep our place in the queue when the freed slot was taken before we resumed
+            if (retry) {
+                waiters.push_front(&w);
+            } else {
+                waiters.push_back(&w);
+            }
+            boost::system::error_code ec;
+            co_await w.timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if (w.conn) {
+                co_return leased(w.conn, start);
+            }
+            retry = true;
+        }
+    }
+    lease leased(pg_connection *c, clock::time_point start) {
+        pg_metrics::local().record(pg_phase::queue_wait, clock::now() - start);
+        return {this, c};
+    }
+    void release(pg_connection *c) {
+        if (!c->s.is_open()) {
+            ++lost;
+            drop(c);
+            return;
+        }
+        if (!waiters.empty()) {
+            wake(c);
+            return;
+        }
+        idle.push_back({c, clock::now()});
+    }
+
+    task<pg_connection *> open() {
+        ++connecting;
+        auto c = std::make_unique<pg_connection>(ctx, connstr);
+        c->auth_executor = opts.auth_executor;
+        try {
+            co_await c->connect();
+        } catch (...) {
+            --connecting;
+            if (!waiters.empty()) {
+                wake(nullptr);
+            }
+            throw;
+        }
+        --connecting;
+        if (lost) {
+            --lost;
+            pg_metrics::local().reconnected();
+        }
+        co_return connections.emplace_back(std::move(c)).get();
+    }
+    void drop(pg_connection *c) {
+        std::erase_if(connections, [c](auto &&p) {return p.get() == c;});
+        if (!waiters.empty()) {
+            wake(nullptr);
+        }
+    }
+    void wake(pg_connection *c) {
+        auto w = waiters.front();
+        waiters.pop_front();
+        w->conn = c;
+        w->timer.cancel();
+    }
+    task<> reap() {
+        while (1) {
+            reap_timer.expires_after(opts.idle_timeout);
+            boost::system::error_code ec;
+            co_await reap_timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            if (ec) {
+                co_return;
+            }
+            auto now = clock::now();
+            while (!idle.empty() && size() > opts.min_size && now - idle.front().since >= opts.idle_timeout) {
+                auto c = idle.front().conn;
+                idle.pop_front();
+                drop(c);
+            }
+        }
+    }
+};
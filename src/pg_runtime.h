@@ -0,0 +1,158 @@
+#pragma once
+
+#include "pg_pool.h"
+
+#include <atomic>
+#include <bit>
+#include <future>
+#include <thread>
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+// one single threaded io_context (shard) per core, every one is run by its own thread pinned to its core
+// when the allowed cpus permit it
+// a connection and everything that touches it stays on the shard it was created on, so there is no locking
+// on the hot path, work is spread over the shards instead
+struct pg_runtime {
+    using work_guard = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+
+    // shard of the calling thread, -1 outside of the runtime threads
+    static inline thread_local size_t current = -1;
+
+    std::vector<std::unique_ptr<boost::asio::io_context>> shards;
+    std::vector<work_guard> work;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> next{};
+
+    pg_runtime(size_t n = std::thread::hardware_concurrency()) {
+        n = std::max<size_t>(n, 1);
+        for (size_t i = 0; i < n; ++i) {
+            // concurrency hint 1: only one thread runs the context, asio uses that to pick its scheduler
+            // and reactor tuning but keeps its locking, wake ups posted from other threads
+            // (pg_submit_queue, pg_sharded_pool::stop) need it
+            auto &ctx = *shards.emplace_back(std::make_unique<boost::asio::io_context>(1));
+            work.emplace_back(ctx.get_executor());
+        }
+    }
+    ~pg_runtime() {
+        stop();
+        join();
+    }
+
+    auto size() const {return shards.size();}
+    auto &operator[](size_t i) {return *shards[i];}
+
+    void start() {
+        for (size_t i = 0; i < size(); ++i) {
+            threads.emplace_back([this, i] {
+                current = i;
+                pin(i);
+                shards[i]->run();
+            });
+        }
+    }
+    // shards exit once they run out of work
+    void stop() {
+        work.clear();
+    }
+    void join() {
+        for (auto &&t : threads) {
+            t.join();
+        }
+        threads.clear();
+    }
+    // round robin
+    size_t next_shard() {
+        return next++ % size();
+    }
+
+    // pins the calling thread to the i-th cpu (modulo their number) it is allowed to run on,
+    // so a restricted cpuset (taskset, cgroups, containers) is respected
+    // returns false and leaves the thread unpinned when that is not possible
+    static bool pin(size_t i) {
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed) != 0) {
+            return false;
+        }
+        auto n = CPU_COUNT(&allowed);
+        if (n == 0) {
+            return false;
+        }
+        auto k = i % n;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed) || k--) {
+                continue;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        }
+        return false;
+#elif defined(_WIN32)
+        DWORD_PTR process_mask, system_mask;
+        if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask) || !process_mask) {
+            return false;
+        }
+        auto k = i % std::popcount((unsigned long long)process_mask);
+        for (int cpu = 0; cpu < sizeof(process_mask) * 8; ++cpu) {
+            if (!(process_mask & ((DWORD_PTR)1 << cpu)) || k--) {
+                continue;
+            }
+            return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+        }
+        return false;
+#else
+        return false;
+#endif
+    }
+};
+
+// a pg_pool per shard, its connections and leases never leave the shard
+// work is spread with spawn(), the task runs on the next shard and gets the pool of that shard
+// stop the pool and join the runtime before destroying it
+struct pg_sharded_pool {
+    pg_runtime &rt;
+    std::vector<std::unique_ptr<pg_pool>> pools;
+
+    pg_sharded_pool(pg_runtime &rt, auto &&connstr, pg_pool::options opts = {}) : rt{rt} {
+        for (size_t i = 0; i < rt.size(); ++i) {
+            pools.emplace_back(std::make_unique<pg_pool>(rt[i], connstr, opts));
+        }
+    }
+
+    // starts every shard pool on its own shard and waits for them, the runtime must be started
+    void start() {
+        std::vector<std::future<void>> started;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            started.emplace_back(boost::asio::co_spawn(rt[i], pools[i]->start(), boost::asio::use_future));
+        }
+        for (auto &&f : started) {
+            f.get();
+        }
+    }
+    void stop() {
+        for (size_t i = 0; i < pools.size(); ++i) {
+            boost::asio::post(rt[i], [p = pools[i].get()] {
+                p->stop();
+            });
+        }
+    }
+    // pool of the calling thread's shard
+    pg_pool &local() {
+        if (pg_runtime::current >= pools.size()) {
+            throw std::runtime_error{"not on a runtime thread"};
+        }
+        return *pools[pg_runtime::current];
+    }
+    // runs f(pg_pool &) -> task<T> on the next shard, completes like co_spawn with the token
+    auto spawn(auto &&f, auto &&token) {
+        auto i = rt.next_shard();
+        return boost::asio::co_spawn(rt[i], [f = std::forward<decltype(f)>(f), p = pools[i].get()]() mutable {
+            return f(*p);
+        }, std::forward<decltype(token)>(token));
+    }
+};
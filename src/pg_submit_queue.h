@@ -0,0 +1,184 @@
+#pragma once
+
+#include "pg_connection.h"
+
+#include <atomic>
+#include <future>
+
+// intrusive multi producer single consumer queue (Vyukov)
+// push is one atomic exchange and one store, no locks and no allocation of its own
+// pop may miss an element whose producer is still in the middle of push, that producer
+// makes it visible right after
+struct mpsc_queue {
+    struct node {
+        std::atomic<node *> next{};
+    };
+
+    std::atomic<node *> head;
+    node *tail;
+    node stub;
+
+    mpsc_queue() : head{&stub}, tail{&stub} {}
+
+    // any thread
+    void push(node *n) {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        auto prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+    // consumer only
+    node *pop() {
+        auto t = tail;
+        auto next = t->next.load(std::memory_order_acquire);
+        if (t == &stub) {
+            if (!next) {
+                return nullptr;
+            }
+            tail = t = next;
+            next = t->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return t;
+        }
+        if (t != head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        push(&stub);
+        next = t->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return t;
+        }
+        return nullptr;
+    }
+};
+
+// lets any thread submit queries to a connection without touching its executor
+// the connection coroutine drains up to max_batch queued queries into one pipeline, so a burst of
+// submissions costs one write and at most one wake up (a post) instead of a handler per query
+// every query of a batch is its own implicit transaction (pg_connection::try_run_each), a server error
+// is the result of its query only and nothing is run twice; any other error breaks the connection,
+// it fails the batch and everything still queued
+// the queue and the connection must outlive the producers
+struct pg_submit_queue {
+    static constexpr inline size_t default_max_batch = 256;
+
+    struct submission : mpsc_queue::node {
+        pg_pipeline::statement st;
+        std::promise<pg_expected<pg_result>> result;
+    };
+
+    pg_connection &c;
+    size_t max_batch;
+    mpsc_queue q;
+    // set by the consumer before it waits, the producer that clears it posts the wake up
+    std::atomic<bool> sleeping{};
+    std::atomic<bool> stopping{};
+    boost::asio::steady_timer wake_timer;
+
+    pg_submit_queue(pg_connection &c, size_t max_batch = default_max_batch)
+        : c{c}, max_batch{max_batch}, wake_timer{c.s.get_executor()} {
+    }
+    ~pg_submit_queue() {
+        while (auto n = q.pop()) {
+            delete (submission *)n;
+        }
+    }
+
+    // runs the consumer on the connection executor
+    void start() {
+        boost::asio::co_spawn(c.s.get_executor(), run(), boost::asio::detached);
+    }
+    // any thread, queued queries are still sent
+    void stop() {
+        stopping = true;
+        wake();
+    }
+    // any thread, text parameters like pg_connection::query()
+    std::future<pg_expected<pg_result>> submit(std::string_view q, auto && ... args) {
+        auto s = new submission;
+        s->st.query = q;
+        s->st.params.reserve(sizeof...(args));
+        (s->st.params.emplace_back(pg_pipeline::to_parameter(args)),...);
+        auto f = s->result.get_future();
+        this->q.push(s);
+        wake();
+        return f;
+    }
+    void wake() {
+        // pairs with the fence in run(): either the consumer sees what was pushed (or stopping),
+        // or this sees the flag, a store followed by a load needs a full fence on both sides
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.exchange(false)) {
+            boost::asio::post(wake_timer.get_executor(), [this] {
+                wake_timer.cancel();
+            });
+        }
+    }
+
+    task<> run() {
+        std::vector<std::unique_ptr<submission>> batch;
+        std::exception_ptr ep;
+        try {
+            while (1) {
+                while (batch.size() < max_batch) {
+                    auto n = q.pop();
+                    if (!n) {
+                        break;
+                    }
+                    batch.emplace_back((submission *)n);
+                }
+                if (!batch.empty()) {
+                    co_await send(batch);
+                    batch.clear();
+                    continue;
+                }
+                if (stopping) {
+                    break;
+                }
+                sleeping = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                // a producer (or stop()) may have come before it could see the flag
+                if (auto n = q.pop()) {
+                    sleeping = false;
+                    batch.emplace_back((submission *)n);
+                    continue;
+                }
+                if (stopping) {
+                    break;
+                }
+                wake_timer.expires_at(boost::asio::steady_timer::time_point::max());
+                boost::system::error_code ec;
+                co_await wake_timer.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
+            }
+        } catch (...) {
+            // the connection is broken, fail everything that is left
+            ep = std::current_exception();
+        }
+        if (ep) {
+            for (auto &&s : batch) {
+                if (s) {
+                    s->result.set_exception(ep);
+                }
+            }
+            while (auto n = q.pop()) {
+                std::unique_ptr<submission> s{(submission *)n};
+                s->result.set_exception(ep);
+            }
+        }
+    }
+    // completed submissions are reset, client side and i/o errors are rethrown
+    task<> send(std::vector<std::unique_ptr<submission>> &batch) {
+        pg_pipeline p;
+        p.statements.reserve(batch.size());
+        for (auto &&s : batch) {
+            p.statements.push_back(std::move(s->st));
+        }
+        auto results = co_await c.try_run_each(p);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i]->result.set_value(std::move(results[i]));
+            batch[i].reset();
+        }
+    }
+};
@@ -0,0 +1,306 @@
+#pragma once
+
+#include "pg_messages.h"
+#include "pg_message_dispatch.h"
+
+#include <boost/pfr.hpp>
+
+// binary format decoders and encoders, the one for every row field is picked at compile time from its type
+// oids lists the column types a field accepts, len is -1 for NULL and only std::optional takes it
+// encode() appends the value without its length
+template <typename T>
+struct pg_type;
+
+inline void pg_check_not_null(i32 len) {
+    if (len < 0) {
+        throw std::runtime_error{"unexpected NULL value"};
+    }
+}
+template <typename T>
+T pg_read_be(const i8 *p, i32 len) {
+    pg_check_not_null(len);
+    if (len != sizeof(T)) {
+        throw std::runtime_error{"bad value length: "s + std::to_string(len)};
+    }
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return std::byteswap(v);
+}
+template <typename T>
+void pg_append_be(std::string &out, T v) {
+    v = std::byteswap(v);
+    out.append((const char *)&v, sizeof(v));
+}
+
+template <>
+struct pg_type<bool> {
+    static constexpr inline i32 oids[] = {16};
+    static void decode(bool &v, const i8 *p, i32 len) {
+        v = pg_read_be<i8>(p, len);
+    }
+    static void encode(bool v, std::string &out) {
+        out += (char)v;
+    }
+};
+
+template <std::signed_integral T> requires (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)
+struct pg_type<T> {
+    // int2, int4, int8
+    static constexpr inline i32 oids[] = {sizeof(T) == 2 ? 21 : sizeof(T) == 4 ? 23 : 20};
+    static void decode(T &v, const i8 *p, i32 len) {
+        v = pg_read_be<T>(p, len);
+    }
+    static void encode(T v, std::string &out) {
+        pg_append_be(out, v);
+    }
+};
+
+template <std::floating_point T> requires (sizeof(T) == 4 || sizeof(T) == 8)
+struct pg_type<T> {
+    using bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+
+    // float4, float8
+    static constexpr inline i32 oids[] = {sizeof(T) == 4 ? 700 : 701};
+    static void decode(T &v, const i8 *p, i32 len) {
+        v = std::bit_cast<T>(pg_read_be<bits>(p, len));
+    }
+    static void encode(T v, std::string &out) {
+        pg_append_be(out, std::bit_cast<bits>(v));
+    }
+};
+
+template <>
+struct pg_type<std::string> {
+    // text, varchar, bpchar, name, json
+    static constexpr inline i32 oids[] = {25, 1043, 1042, 19, 114};
+    static void decode(std::string &v, const i8 *p, i32 len) {
+        pg_check_not_null(len);
+        v.assign((const char *)p, len);
+    }
+    static void encode(std::string_view v, std::string &out) {
+        out += v;
+    }
+};
+
+// points into the message, use it only while the message is alive
+template <>
+struct pg_type<std::string_view> {
+    static constexpr inline auto &oids = pg_type<std::string>::oids;
+    static void decode(std::string_view &v, const i8 *p, i32 len) {
+        pg_check_not_null(len);
+        v = {(const char *)p, (size_t)len};
+    }
+    static void encode(std::string_view v, std::string &out) {
+        out += v;
+    }
+};
+
+template <>
+struct pg_type<std::vector<i8>> {
+    // bytea
+    static constexpr inline i32 oids[] = {17};
+    static void decode(std::vector<i8> &v, const i8 *p, i32 len) {
+        pg_check_not_null(len);
+        v.assign(p, p + len);
+    }
+    static void encode(const std::vector<i8> &v, std::string &out) {
+        out.append((const char *)v.data(), v.size());
+    }
+};
+
+template <typename T>
+struct pg_type<std::optional<T>> {
+    static constexpr inline auto &oids = pg_type<T>::oids;
+    static void decode(std::optional<T> &v, const i8 *p, i32 len) {
+        if (len < 0) {
+            v.reset();
+            return;
+        }
+        pg_type<T>::decode(v.emplace(), p, len);
+    }
+};
+
+// appends the length and the binary value, std::optional and std::nullopt may be NULL
+template <typename T>
+void pg_encode_field(std::string &out, const T &v) {
+    if constexpr (std::is_same_v<T, std::nullopt_t>) {
+        pg_append_be(out, -1);
+    } else if constexpr (requires {v.has_value(); *v;}) {
+        if (!v) {
+            pg_append_be(out, -1);
+            return;
+        }
+        pg_encode_field(out, *v);
+    } else if constexpr (std::is_convertible_v<T, std::string_view> && !std::is_same_v<T, std::string_view>) {
+        pg_encode_field(out, std::string_view{v});
+    } else {
+        auto pos = out.size();
+        pg_append_be(out, 0);
+        pg_type<T>::encode(v, out);
+        i32 len = out.size() - pos - sizeof(i32);
+        len = std::byteswap(len);
+        memcpy(out.data() + pos, &len, sizeof(len));
+    }
+}
+
+// columns map to Row fields by position, checked once per result rather than per row
+template <typename Row>
+void pg_check_columns(const auto &fields) {
+    constexpr auto n = boost::pfr::tuple_size_v<Row>;
+    if (fields.size() != n) {
+        throw std::runtime_error{std::format("row has {} fields, result has {} columns", n, fields.size())};
+    }
+    auto f = fields.begin();
+    [&]<size_t ... I>(std::index_sequence<I...>) {
+        auto check = [&]<typename T>(size_t i) {
+            auto oid = f->the_object_id_of_the_field_s_data_type;
+            if (std::ranges::find(pg_type<T>::oids, oid) == std::end(pg_type<T>::oids)) {
+                throw std::runtime_error{std::format("column {} ({}): type oid {} does not match row field {}",
+                    i, f->the_field_name, oid, i)};
+            }
+            ++f;
+        };
+        (check.template operator()<boost::pfr::tuple_element_t<I, Row>>(I), ...);
+    }(std::make_index_sequence<n>{});
+}
+// body of a data row (or a binary COPY tuple) in binary format: column count followed by the columns
+template <typename Row>
+Row pg_decode_row(std::span<const i8> body) {
+    auto p = body.data() + sizeof(be_i16);
+    auto end = body.data() + body.size();
+    be_i16 columns;
+    if (body.size() < sizeof(columns)) {
+        throw std::runtime_error{"truncated data row"};
+    }
+    memcpy(&columns, body.data(), sizeof(columns));
+    if (columns != (i16)boost::pfr::tuple_size_v<Row>) {
+        throw std::runtime_error{"unexpected number of columns"};
+    }
+    Row r;
+    boost::pfr::for_each_field(r, [&](auto &f) {
+        be_i32 len;
+        if (end - p < (ptrdiff_t)sizeof(len)) {
+            throw std::runtime_error{"truncated data row"};
+        }
+        memcpy(&len, p, sizeof(len));
+        p += sizeof(len);
+        if (end - p < len) {
+            throw std::runtime_error{"truncated data row"};
+        }
+        pg_type<std::decay_t<decltype(f)>>::decode(f, p, len);
+        if (len > 0) {
+            p += len;
+        }
+    });
+    return r;
+}
+template <typename Row>
+Row pg_decode_row(const message_view &m) {
+    return pg_decode_row<Row>(m.data.subspan(sizeof(header)));
+}
+
+// rows kept past the message they were decoded from must not point into it (std::string_view fields)
+template <typename T>
+constexpr inline bool pg_owning_field = !std::is_same_v<T, std::string_view>;
+template <typename T>
+constexpr inline bool pg_owning_field<std::optional<T>> = pg_owning_field<T>;
+template <typename Row>
+constexpr inline bool pg_owning_row = []<size_t ... I>(std::index_sequence<I...>) {
+    return (pg_owning_field<boost::pfr::tuple_element_t<I, Row>> && ...);
+}(std::make_index_sequence<boost::pfr::tuple_size_v<Row>>{});
+
+// one column of a data row, points into the message
+// len is -1 for NULL
+struct column_ref {
+    const i8 *p;
+    i32 len;
+
+    bool is_null() const {return len < 0;}
+    size_t size() const {return len < 0 ? 0 : len;}
+    auto bytes() const {return std::span<const i8>{p, size()};}
+    auto text() const {return std::string_view{(const char *)p, size()};}
+    // binary format value
+    template <typename T>
+    T as() const {
+        T v;
+        pg_type<T>::decode(v, p, len);
+        return v;
+    }
+};
+
+// lazy cursor over a data_row, nothing is copied
+// column offsets are indexed on first access and only up to the requested column,
+// so reading a few leading columns of a wide row does not walk the rest
+struct row_ref {
+    static constexpr inline size_t inline_columns = 32;
+
+    // column count followed by the columns
+    std::span<const i8> data;
+    i16 columns;
+    // start of every indexed column (its length field), the first ones are kept inline
+    mutable std::array<const i8 *, inline_columns> starts;
+    mutable std::vector<const i8 *> more_starts;
+    mutable i16 indexed{};
+
+    row_ref(const message_view &m) : row_ref{body(m)} {}
+    // data row body or a binary COPY tuple
+    row_ref(std::span<const i8> body) : data{body} {
+        be_i16 n;
+        if (data.size() < sizeof(n)) {
+            throw std::runtime_error{"truncated data row"};
+        }
+        memcpy(&n, data.data(), sizeof(n));
+        columns = n;
+        if (columns < 0) {
+            throw std::runtime_error{"bad number of columns"};
+        }
+        starts[0] = data.data() + sizeof(n);
+    }
+    static std::span<const i8> body(const message_view &m) {
+        if (message_type<data_row> != m.h.type) {
+            throw std::runtime_error{"unexpected message: "s + (char)m.h.type};
+        }
+        return m.data.subspan(sizeof(header));
+    }
+
+    auto size() const {return columns;}
+    column_ref operator[](i16 i) const {
+        if (i < 0 || i >= columns) {
+            throw std::out_of_range{"column " + std::to_string(i) + " of " + std::to_string(columns)};
+        }
+        while (indexed <= i) {
+            auto p = start(indexed);
+            auto len = length(p);
+            if (indexed + 1 < columns) {
+                set_start(indexed + 1, p + sizeof(be_i32) + (len < 0 ? 0 : len));
+            }
+            ++indexed;
+        }
+        auto p = start(i);
+        return {p + sizeof(be_i32), length(p)};
+    }
+
+    const i8 *start(i16 i) const {
+        return i < inline_columns ? starts[i] : more_starts[i - inline_columns];
+    }
+    void set_start(i16 i, const i8 *p) const {
+        if (i < inline_columns) {
+            starts[i] = p;
+        } else {
+            more_starts.push_back(p);
+        }
+    }
+    // checks the column fits into the message
+    i32 length(const i8 *p) const {
+        auto end = data.data() + data.size();
+        be_i32 len;
+        if (end - p < (ptrdiff_t)sizeof(len)) {
+            throw std::runtime_error{"truncated data row"};
+        }
+        memcpy(&len, p, sizeof(len));
+        if (end - p - (ptrdiff_t)sizeof(len) < len) {
+            throw std::runtime_error{"truncated data row"};
+        }
+        return len;
+    }
+};
@@ -22,17 +22,58 @@ void build(Solution &s) {
         t.PackageDefinitions = true;
         t += "src/main.cpp";
 
-        /*t.addCommand()
-            << cmd::prog(pg_message_formats_parser)
-            << cmd::wdir(t.BinaryDir)
-            << cmd::end()
-            << cmd::out("pg_messages.h")
-            ;*/
+        // pg_messages.h and the dispatch, encoder and decoder headers are generated from the pinned protocol docs
+        // and checked in, they are not regenerated on build. To check them, run the generator in a scratch directory:
+        //   pg_message_formats_parser --check <source dir>/src
+        // It writes the headers there and fails when any of them differs from the one in src/.
 
         //t += router_relay;
         t += "pub.egorpugin.crypto"_dep;
         t += "pub.egorpugin.primitives.templates2"_dep;
         t.Public += "org.sw.demo.boost.asio"_dep;
+        t.Public += "org.sw.demo.boost.pfr"_dep;
+        t += "pub.egorpugin.primitives.sw.main"_dep;
+    }
+
+    auto &pg_client_bench = s.addExecutable("pg_client_bench");
+    {
+        auto &t = pg_client_bench;
+        t += cpp26;
+        t.PackageDefinitions = true;
+        t += "src/bench.cpp";
+
+        t += "pub.egorpugin.crypto"_dep;
+        t += "pub.egorpugin.primitives.templates2"_dep;
+        t.Public += "org.sw.demo.boost.asio"_dep;
+        t.Public += "org.sw.demo.boost.pfr"_dep;
+        t += "pub.egorpugin.primitives.sw.main"_dep;
+    }
+
+    auto &pg_client_loadgen = s.addExecutable("pg_client_loadgen");
+    {
+        auto &t = pg_client_loadgen;
+        t += cpp26;
+        t.PackageDefinitions = true;
+        t += "src/loadgen.cpp";
+
+        t += "pub.egorpugin.crypto"_dep;
+        t += "pub.egorpugin.primitives.templates2"_dep;
+        t.Public += "org.sw.demo.boost.asio"_dep;
+        t.Public += "org.sw.demo.boost.pfr"_dep;
+        t += "pub.egorpugin.primitives.sw.main"_dep;
+    }
+
+    auto &pg_client_microbench = s.addExecutable("pg_client_microbench");
+    {
+        auto &t = pg_client_microbench;
+        t += cpp26;
+        t.PackageDefinitions = true;
+        t += "src/microbench.cpp";
+
+        t += "pub.egorpugin.crypto"_dep;
+        t += "pub.egorpugin.primitives.templates2"_dep;
+        t.Public += "org.sw.demo.boost.asio"_dep;
+        t.Public += "org.sw.demo.boost.pfr"_dep;
         t += "pub.egorpugin.primitives.sw.main"_dep;
     }
 }